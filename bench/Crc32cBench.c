@@ -0,0 +1,82 @@
+#include <time.h>
+#include <string.h>
+
+#include "Crc32c.h"
+#include "BasicList.h"
+
+/* Throughput of CRC32C and of verifying a framed list, with memcpy as the
+ *  reference they should stay close to
+ */
+
+#define BENCH_SIZE          (64 * 1024 * 1024)
+#define BENCH_REPETITIONS   16
+#define BENCH_ELEMENT_SIZE  4096
+
+static volatile size_t Sink;
+
+static double Now(void) {
+    struct timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return Time.tv_sec + Time.tv_nsec / 1e9;
+}
+
+static void Report(const char* Name, double Start) {
+    double Seconds = Now() - Start;
+    double Bytes = (double)BENCH_SIZE * BENCH_REPETITIONS;
+
+    printf("%-28s %8.2f GB/s\n", Name, Bytes / Seconds / 1e9);
+}
+
+int main(void) {
+    OPAQUE_MEMORY A, B;
+    double Start;
+
+    SetupOpaqueMemory(&A, BENCH_SIZE);
+    SetupOpaqueMemory(&B, BENCH_SIZE);
+    for (size_t Ind = 0; Ind != BENCH_SIZE; Ind++) {
+        CAST_MEMORY_AS(&A, uint8_t)[Ind] = (uint8_t)('a' + Ind % 23);
+    }
+
+    Start = Now();
+    for (int Rep = 0; Rep != BENCH_REPETITIONS; Rep++) {
+        Sink = Crc32c(0, OPAQUE_MEMORY_DATA(&A), BENCH_SIZE);
+    }
+    Report("Crc32c", Start);
+
+    Start = Now();
+    for (int Rep = 0; Rep != BENCH_REPETITIONS; Rep++) {
+        memcpy(OPAQUE_MEMORY_DATA(&B), OPAQUE_MEMORY_DATA(&A), BENCH_SIZE);
+        Sink = CAST_MEMORY_AS(&B, uint8_t)[Rep];
+    }
+    Report("memcpy", Start);
+
+    // Same bytes as a framed list of BENCH_ELEMENT_SIZE views
+    LIST* List = AllocateList();
+    OPAQUE_MEMORY Element;
+    ITERATE_SLICES(&A, BENCH_ELEMENT_SIZE, Element) {
+        MemoryListInsert(List, Element);
+    }
+    OPAQUE_MEMORY* Frame = SerializeMemoryListFramed(List);
+
+    Start = Now();
+    for (int Rep = 0; Rep != BENCH_REPETITIONS; Rep++) {
+        LIST* Views = DeSerializeMemoryListViewsFramed(Frame);
+        Sink = Views->Length;
+        FreeMemoryList(Views);
+    }
+    Report("Framed list (views)", Start);
+
+    Start = Now();
+    for (int Rep = 0; Rep != BENCH_REPETITIONS; Rep++) {
+        LIST* Copies = DeSerializeMemoryListFramed(Frame);
+        Sink = Copies->Length;
+        FreeMemoryList(Copies);
+    }
+    Report("Framed list (copies)", Start);
+
+    FreeOpaqueMemory(Frame);
+    FreeMemoryList(List);
+    ClearOpaqueMemory(&A);
+    ClearOpaqueMemory(&B);
+    return 0;
+}
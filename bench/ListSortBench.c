@@ -0,0 +1,132 @@
+#include <time.h>
+#include <stdlib.h>
+
+#include "ListSort.h"
+
+/* Time to sort a Data list in place, against copying it into an array, qsort
+ *  and rebuilding the list
+ */
+
+#define BENCH_LENGTH        (1024 * 1024)
+#define BENCH_REPETITIONS   4
+
+static double Now(void) {
+    struct timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return Time.tv_sec + Time.tv_nsec / 1e9;
+}
+
+static void Report(const char* Name, double Seconds) {
+    printf("%-28s %8.2f ms\n", Name, Seconds / BENCH_REPETITIONS * 1e3);
+}
+
+static int CompareQsort(const void* Left, const void* Right) {
+    return CompareUnsignedData(Left, Right, NULL);
+}
+
+static uint64_t NextRandom(uint64_t* State) {
+    *State ^= *State << 13;
+    *State ^= *State >> 7;
+    *State ^= *State << 17;
+    return *State;
+}
+
+/* Build a list of BENCH_LENGTH pseudo random values under `Mask`
+ * Links are shuffled with a fixed seed, so every sort walks nodes scattered
+ *  over memory the same way whatever the allocator did before
+ */
+static LIST* RandomList(uintptr_t Mask) {
+    LIST* List = AllocateList();
+    PRIMITIVE_DATA_ELEMENT** Links = Malloc(BENCH_LENGTH * sizeof(PRIMITIVE_DATA_ELEMENT*));
+    uint64_t State = 88172645463325252ULL;
+
+    for (size_t Ind = 0; Ind != BENCH_LENGTH; Ind++) {
+        DataListInsert(List, GENERIC_DATA(uintptr_t, 0));
+        Links[Ind] = List->Tail;
+    }
+
+    for (size_t Ind = BENCH_LENGTH - 1; Ind != 0; Ind--) {
+        size_t Other = NextRandom(&State) % (Ind + 1);
+        PRIMITIVE_DATA_ELEMENT* Swap = Links[Ind];
+        Links[Ind] = Links[Other];
+        Links[Other] = Swap;
+    }
+
+    for (size_t Ind = 0; Ind != BENCH_LENGTH; Ind++) {
+        Links[Ind]->Data.Val_uintptr_t = (uintptr_t)NextRandom(&State) & Mask;
+        Links[Ind]->Next = (Ind + 1 != BENCH_LENGTH) ? Links[Ind + 1] : NULL;
+    }
+    List->Head = Links[0];
+    List->Tail = Links[BENCH_LENGTH - 1];
+
+    Free(Links);
+    return List;
+}
+
+static double SortWithQsort(uintptr_t Mask) {
+    LIST* List = RandomList(Mask);
+    double Start = Now();
+
+    OPAQUE_DATA* Array = Malloc(List->Length * sizeof(OPAQUE_DATA));
+    size_t Length = 0;
+    OPAQUE_DATA Element;
+    ITERATE_OPAQUE_DATA_TYPE(List, Element) {
+        Array[Length++] = Element;
+    }
+    FreeDataList(List);
+    List = AllocateList();
+
+    qsort(Array, Length, sizeof(OPAQUE_DATA), CompareQsort);
+    for (size_t Ind = 0; Ind != Length; Ind++) {
+        DataListInsert(List, Array[Ind]);
+    }
+
+    double Seconds = Now() - Start;
+    Free(Array);
+    FreeDataList(List);
+    return Seconds;
+}
+
+static double SortWithMergeSort(uintptr_t Mask) {
+    LIST* List = RandomList(Mask);
+    double Start = Now();
+
+    SortDataList(List, CompareUnsignedData, NULL);
+
+    double Seconds = Now() - Start;
+    FreeDataList(List);
+    return Seconds;
+}
+
+static double SortWithRadixSort(uintptr_t Mask) {
+    LIST* List = RandomList(Mask);
+    double Start = Now();
+
+    RadixSortDataList(List, FALSE);
+
+    double Seconds = Now() - Start;
+    FreeDataList(List);
+    return Seconds;
+}
+
+int main(void) {
+    const uintptr_t Masks[] = { UINTPTR_MAX, 0xffff, 0xff };
+    const char* Names[][3] = {
+        { "qsort + rebuild (64 bit)", "SortDataList (64 bit)", "RadixSortDataList (64 bit)" },
+        { "qsort + rebuild (16 bit)", "SortDataList (16 bit)", "RadixSortDataList (16 bit)" },
+        { "qsort + rebuild (8 bit)", "SortDataList (8 bit)", "RadixSortDataList (8 bit)" },
+    };
+
+    for (size_t MaskInd = 0; MaskInd != sizeof(Masks) / sizeof(Masks[0]); MaskInd++) {
+        double Qsort = 0, Merge = 0, Radix = 0;
+        for (int Rep = 0; Rep != BENCH_REPETITIONS; Rep++) {
+            Qsort += SortWithQsort(Masks[MaskInd]);
+            Merge += SortWithMergeSort(Masks[MaskInd]);
+            Radix += SortWithRadixSort(Masks[MaskInd]);
+        }
+        Report(Names[MaskInd][0], Qsort);
+        Report(Names[MaskInd][1], Merge);
+        Report(Names[MaskInd][2], Radix);
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <time.h>
+
+#include "Opaque.h"
+
+/* Throughput of the Opaque comparison, search and fill primitives, with the
+ *  equivalent libc call (where there is one) as reference
+ */
+
+#define BENCH_SIZE          (64 * 1024 * 1024)
+#define BENCH_REPETITIONS   16
+
+static volatile size_t Sink;
+
+static double Now(void) {
+    struct timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return Time.tv_sec + Time.tv_nsec / 1e9;
+}
+
+static void Report(const char* Name, double Start) {
+    double Seconds = Now() - Start;
+    double Bytes = (double)BENCH_SIZE * BENCH_REPETITIONS;
+
+    printf("%-28s %8.2f GB/s\n", Name, Bytes / Seconds / 1e9);
+}
+
+int main(void) {
+    OPAQUE_MEMORY A, B;
+    double Start;
+    const char Pattern[] = "needle!";
+
+    SetupOpaqueMemory(&A, BENCH_SIZE);
+    SetupOpaqueMemory(&B, BENCH_SIZE);
+    for (size_t Ind = 0; Ind != BENCH_SIZE; Ind++) {
+        CAST_MEMORY_AS(&A, uint8_t)[Ind] = (uint8_t)('a' + Ind % 23);
+    }
+    Memcpy(OPAQUE_MEMORY_DATA(&B), OPAQUE_MEMORY_DATA(&A), BENCH_SIZE);
+
+    Start = Now();
+    for (int Rep = 0; Rep != BENCH_REPETITIONS; Rep++) {
+        Sink = OpaqueMemoryEqual(&A, &B);
+    }
+    Report("OpaqueMemoryEqual", Start);
+
+    Start = Now();
+    for (int Rep = 0; Rep != BENCH_REPETITIONS; Rep++) {
+        Sink = memcmp(OPAQUE_MEMORY_DATA(&A), OPAQUE_MEMORY_DATA(&B), BENCH_SIZE);
+    }
+    Report("memcmp", Start);
+
+    Start = Now();
+    for (int Rep = 0; Rep != BENCH_REPETITIONS; Rep++) {
+        Sink = FindByteInOpaqueMemory(&A, 'Z', 0);
+    }
+    Report("FindByteInOpaqueMemory", Start);
+
+    Start = Now();
+    for (int Rep = 0; Rep != BENCH_REPETITIONS; Rep++) {
+        Sink = (size_t)memchr(OPAQUE_MEMORY_DATA(&A), 'Z', BENCH_SIZE);
+    }
+    Report("memchr", Start);
+
+    Start = Now();
+    for (int Rep = 0; Rep != BENCH_REPETITIONS; Rep++) {
+        Sink = FindInOpaqueMemory(&A, Pattern, sizeof(Pattern) - 1, 0);
+    }
+    Report("FindInOpaqueMemory", Start);
+
+    Start = Now();
+    for (int Rep = 0; Rep != BENCH_REPETITIONS; Rep++) {
+        Sink = CountByteInOpaqueMemory(&A, 'e');
+    }
+    Report("CountByteInOpaqueMemory", Start);
+
+    Start = Now();
+    for (int Rep = 0; Rep != BENCH_REPETITIONS; Rep++) {
+        FillOpaqueMemory(&B, (uint8_t)Rep);
+    }
+    Report("FillOpaqueMemory", Start);
+
+    Start = Now();
+    for (int Rep = 0; Rep != BENCH_REPETITIONS; Rep++) {
+        memset(OPAQUE_MEMORY_DATA(&B), Rep, BENCH_SIZE);
+    }
+    Report("memset", Start);
+
+    ClearOpaqueMemory(&A);
+    ClearOpaqueMemory(&B);
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Zygote.h"
+
+/* Start a zygote, spawn workers from it (also while a silent client holds a
+ *  connection open) and stop it
+ */
+
+#define DEMO_SOCKET  "/tmp/ZygoteDemo.sock"
+#define DEMO_WORKERS 3
+
+static int Config = 0;
+static int Cache = 0;
+static pid_t SeededIn = 0;
+
+static void LoadConfig(void) {
+    Config++;
+}
+
+static void WarmCache(void) {
+    Cache = Config + 1;
+}
+
+static void SeedWorker(void) {
+    SeededIn = getpid();
+}
+
+REGISTER_INDEPENDENT_CONSTRUCTOR(LoadConfig);
+REGISTER_DEPENDENT_CONSTRUCTOR(WarmCache, LoadConfig);
+REGISTER_INDEPENDENT_POST_FORK_CONSTRUCTOR(SeedWorker);
+
+/* Connect to the zygote without sending a request */
+static int ConnectSilently(void) {
+    struct sockaddr_un Address = { .sun_family = AF_UNIX, .sun_path = DEMO_SOCKET };
+    int Connection = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    int Connected = connect(Connection, (struct sockaddr*)&Address, sizeof(Address));
+    assert(Connection != -1 && Connected == 0);
+    return Connection;
+}
+
+int main(void) {
+    int Reports[2];
+    int Status;
+
+    // Workers are children of the zygote, they report back through a pipe
+    int Piped = pipe(Reports);
+    assert(Piped == 0);
+
+    pid_t Zygote = fork();
+    assert(Zygote != -1);
+    if (Zygote == 0) {
+        if (RunInitializationZygote(DEMO_SOCKET) == TRUE) {
+            // Fork safe handlers ran once in the zygote, post fork ones here
+            pid_t Report = (Config == 1 && Cache == 2 && SeededIn == getpid()) ? getpid() : -1;
+            _exit(write(Reports[1], &Report, sizeof(Report)) == sizeof(Report) ? 0 : 1);
+        }
+        // The post fork handlers never ran in the zygote
+        _exit(SeededIn == 0 ? 0 : 1);
+    }
+    close(Reports[1]);
+
+    // Wait for the zygote to listen
+    pid_t Workers[DEMO_WORKERS];
+    Workers[0] = -1;
+    for (int Try = 0; Try != 500 && Workers[0] == -1; Try++) {
+        Workers[0] = SpawnFromZygote(DEMO_SOCKET);
+        if (Workers[0] == -1) {
+            usleep(10000);
+        }
+    }
+    assert(Workers[0] > 0);
+
+    // The silent client is dropped after ZYGOTE_REQUEST_TIMEOUT_MS
+    int Silent = ConnectSilently();
+    for (int WorkerInd = 1; WorkerInd != DEMO_WORKERS; WorkerInd++) {
+        Workers[WorkerInd] = SpawnFromZygote(DEMO_SOCKET);
+        assert(Workers[WorkerInd] > 0);
+    }
+    close(Silent);
+
+    for (int ReportInd = 0; ReportInd != DEMO_WORKERS; ReportInd++) {
+        pid_t Report = -1;
+        ssize_t ReadAmmount = read(Reports[0], &Report, sizeof(Report));
+        BOOLEAN Known = FALSE;
+        for (int WorkerInd = 0; WorkerInd != DEMO_WORKERS; WorkerInd++) {
+            Known = Known || (Report == Workers[WorkerInd]);
+        }
+        assert(ReadAmmount == sizeof(Report) && Known == TRUE);
+    }
+
+    BOOLEAN Stopped = StopZygote(DEMO_SOCKET);
+    pid_t Reaped = waitpid(Zygote, &Status, 0);
+    assert(Stopped == TRUE && Reaped == Zygote);
+    assert(WIFEXITED(Status) && WEXITSTATUS(Status) == 0);
+    assert(access(DEMO_SOCKET, F_OK) != 0);
+
+    printf("Spawned %d workers from zygote %d\n", DEMO_WORKERS, Zygote);
+    return 0;
+}
@@ -5,6 +5,7 @@
 
 /* For NO_DATA_ELEMENT to be compatible with Primitive and Memory, Next
  * must always be the first element
+ * It is also the link embedded into structures kept in intrusive lists
  */
 TYPE_STRUCT(NO_DATA_ELEMENT) {
     NO_DATA_ELEMENT* Next;
@@ -26,7 +27,8 @@ TYPE_STRUCT(MEMORY_DATA_ELEMENT){
 typedef enum{
     NoDataType,
     PrimitiveDataType,
-    MemoryDataType
+    MemoryDataType,
+    IntrusiveDataType
 }LIST_DATA_TYPE;
 #endif
 
@@ -57,6 +59,15 @@ for (MEMORY_DATA_ELEMENT* DataElement = ((List)->Head); \
         ((Var) = ((DataElement)->Memory), 1);           \
     (DataElement) = (DataElement->Next))
 
+/* Iterate an intrusive list of `Type` structures linked through their `Field`
+ *  NO_DATA_ELEMENT
+ */
+#define ITERATE_INTRUSIVE_TYPE(List, Type, Field, Var)                    \
+for (NO_DATA_ELEMENT* IntrusiveElement = ((List)->Head);                  \
+        (IntrusiveElement != NULL) &&                                     \
+        ((Var) = CONTAINER_OF(IntrusiveElement, Type, Field), 1);         \
+    (IntrusiveElement) = (IntrusiveElement->Next))
+
 /* Allocate a new list */
 LIST* AllocateList(void);
 
@@ -66,8 +77,17 @@ void DataListInsert(LIST* List, OPAQUE_DATA NewData);
 /* Insert OPAQUE_MEMORY into `List` */
 void MemoryListInsert(LIST* List, OPAQUE_MEMORY NewMemory);
 
+/* Insert the `Link` embedded in some structure into `List`
+ * No memory is allocated, the structure must outlive its' presence in `List`
+ */
+void IntrusiveListInsert(LIST* List, NO_DATA_ELEMENT* Link);
+
+/* Remove and return the first link of an intrusive `List` (NULL if empty) */
+NO_DATA_ELEMENT* IntrusiveListPop(LIST* List);
+
 /* Allocate and recover list from provided memory
  * `ElementSize` is the size of each list element to be recovered
+ * Returns NULL if `Memory` isn't a whole number of elements
  */
 LIST* DeSerializeDataList(OPAQUE_MEMORY* Memory, size_t ElementSize);
 
@@ -93,17 +113,44 @@ OPAQUE_MEMORY* SerializeMemoryList(LIST* List);
  */
 OPAQUE_MEMORY* SerializeMemoryListElements(LIST* List);
 
-/* Allocate and recover list from provided memory */
+/* Allocate and recover list from provided memory
+ * Returns NULL if a length field runs past the end of `Memory`
+ */
 LIST* DeSerializeMemoryList(OPAQUE_MEMORY* Memory);
 
+/* Same as DeSerializeMemoryList, but elements are views into `Memory` instead
+ *  of copies. `Memory` must outlive the list
+ */
+LIST* DeSerializeMemoryListViews(OPAQUE_MEMORY* Memory);
+
+/*                      Framed serialization
+ * Same payloads as above, wrapped in a frame (see Frame.h) with a magic
+ *  number, version, element count and per block CRC32C
+ * Deserialization verifies the whole frame before building the list and
+ *  returns NULL if anything is off
+ */
+OPAQUE_MEMORY* SerializeMemoryListFramed(LIST* List);
+LIST* DeSerializeMemoryListFramed(OPAQUE_MEMORY* Frame);
+
+/* Elements are views into `Frame`, which must outlive the list */
+LIST* DeSerializeMemoryListViewsFramed(OPAQUE_MEMORY* Frame);
+
+/* `ElementSize` is stored in the frame */
+OPAQUE_MEMORY* SerializeDataListFramed(LIST* List, size_t ElementSize);
+LIST* DeSerializeDataListFramed(OPAQUE_MEMORY* Frame);
+
 /* Clear all elements in Data List */
 void ClearDataList(LIST* List);
 
 /* Clear all elements in Memory List */
 void ClearMemoryList(LIST* List);
 
+/* Unlink all elements in Intrusive List. Their structures aren't touched */
+void ClearIntrusiveList(LIST* List);
+
 void FreeDataList(LIST* List);
 void FreeMemoryList(LIST* List);
+void FreeIntrusiveList(LIST* List);
 
 
 #ifdef ENABLE_SANITY_CHECKS
@@ -130,6 +177,9 @@ void AssertSaneMemoryList(LIST* List);
 // Validate Data is a Memory List and its' sane
 void AssertSaneDataList(LIST* List);
 
+// Validate List is an Intrusive List and its' sane
+void AssertSaneIntrusiveList(LIST* List);
+
 #endif /* ENABLE_SANITY_CHECKS */
 
 #endif /* BASIC_LIST_H */
\ No newline at end of file
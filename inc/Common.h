@@ -2,6 +2,7 @@
 #define COMMON_H
 
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -64,6 +65,21 @@ typedef unsigned char BOOLEAN;
  */
 #define GEN_OVERLOAD(NAME, ...) _OVERLOAD_GLUE(NAME, _OVERLOAD_ARG_COUNT(__VA_ARGS__))
 
+/* Expand to `Macro(Argument)` for each argument, comma separated (up to 9) */
+#define APPLY_EACH(Macro, ...) \
+GLUE1(_APPLY_EACH_, COUNT_ARGUMENTS(__VA_ARGS__))(Macro, ## __VA_ARGS__)
+
+#define _APPLY_EACH_0(M, ...)
+#define _APPLY_EACH_1(M, X)      M(X)
+#define _APPLY_EACH_2(M, X, ...) M(X), _APPLY_EACH_1(M, __VA_ARGS__)
+#define _APPLY_EACH_3(M, X, ...) M(X), _APPLY_EACH_2(M, __VA_ARGS__)
+#define _APPLY_EACH_4(M, X, ...) M(X), _APPLY_EACH_3(M, __VA_ARGS__)
+#define _APPLY_EACH_5(M, X, ...) M(X), _APPLY_EACH_4(M, __VA_ARGS__)
+#define _APPLY_EACH_6(M, X, ...) M(X), _APPLY_EACH_5(M, __VA_ARGS__)
+#define _APPLY_EACH_7(M, X, ...) M(X), _APPLY_EACH_6(M, __VA_ARGS__)
+#define _APPLY_EACH_8(M, X, ...) M(X), _APPLY_EACH_7(M, __VA_ARGS__)
+#define _APPLY_EACH_9(M, X, ...) M(X), _APPLY_EACH_8(M, __VA_ARGS__)
+
 
 /* struct typedef which allows self-referencing without needing the struct
  * keyword in the Fields type
@@ -91,6 +107,10 @@ TYPE* VAR = (TYPE*)Malloc(sizeof(TYPE))
 #define DONT_PAD __attribute__((packed))
 #define FIELD_SIZE(Struct, Field) (sizeof(((Struct*)0)->Field))
 
+/* Recover the address of the `Type` structure whose `Field` is at `Pointer` */
+#define CONTAINER_OF(Pointer, Type, Field) \
+((Type*)((char*)(Pointer) - offsetof(Type, Field)))
+
 //          Common data structures, their macros and functions
 
 /* Copy the data provided into a new generic memory location */
@@ -0,0 +1,13 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* CRC32C (Castagnoli) of `Size` bytes at `Data`, continuing from `Crc` (0 to
+ *  start). Uses the SSE4.2 crc32 instruction when the running CPU has it and
+ *  slicing-by-8 tables otherwise
+ */
+uint32_t Crc32c(uint32_t Crc, const void* Data, size_t Size);
+
+#endif /* CRC32C_H */
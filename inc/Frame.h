@@ -0,0 +1,55 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+#include "Common.h"
+#include "Opaque.h"
+
+/*                      Framed containers
+ * Layout: [ FRAME_HEADER | Block CRC 1 .. Block CRC N | Payload ]
+ * The payload is split in blocks of `BlockSize` bytes, each one with its' own
+ *  CRC32C. `HeaderCrc` covers the header (with `HeaderCrc` as 0) and the block
+ *  CRC table, so a damaged frame is rejected before the payload is read
+ * Fields are stored in the byte order of the machine that wrote the frame
+ */
+#define FRAME_MAGIC       UINT32_C(0x4651504f) // "OPQF" on little endian
+#define FRAME_VERSION     1
+#define FRAME_BLOCK_SIZE  (64 * 1024)
+
+typedef enum FRAME_KIND {
+    FrameMemoryList = 1,
+    FrameDataList   = 2,
+} FRAME_KIND;
+
+TYPE_STRUCT(FRAME_HEADER) {
+    uint32_t Magic;
+    uint16_t Version;
+    uint16_t Kind;
+    uint32_t ElementSize;   // 0 when elements carry their' own size
+    uint32_t BlockSize;
+    uint64_t ElementCount;
+    uint64_t PayloadSize;
+    uint32_t HeaderCrc;
+    uint32_t Reserved;
+};
+
+/* Allocate a frame with room for `PayloadSize` bytes of payload
+ * Write the payload at FramePayload and then call SealFrame
+ */
+OPAQUE_MEMORY* AllocateFrame(FRAME_KIND Kind, uint64_t ElementCount,
+                             uint32_t ElementSize, size_t PayloadSize);
+
+uint8_t* FramePayload(OPAQUE_MEMORY* Frame);
+
+/* Compute the CRCs of a written frame */
+void SealFrame(OPAQUE_MEMORY* Frame);
+
+/* Validate `Frame` as a frame of `Kind`
+ * On success copies its' header into `Header`, sets `Payload` to a view of the
+ *  payload and returns TRUE. Returns FALSE on the first inconsistency: wrong
+ *  magic, version or kind, sizes that don't add up or a CRC mismatch
+ */
+BOOLEAN OpenFrame(OPAQUE_MEMORY* Frame, FRAME_KIND Kind, FRAME_HEADER* Header,
+                  OPAQUE_MEMORY* Payload);
+
+#endif /* FRAME_H */
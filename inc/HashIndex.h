@@ -0,0 +1,70 @@
+#ifndef HASH_INDEX_H
+#define HASH_INDEX_H
+
+#include <stdint.h>
+#include "Common.h"
+
+/*                      String hashing
+ * HASH_NAME hashes a string literal of up to HASH_NAME_MAX_LENGTH characters
+ *  into a constant the compiler folds at build time. HashName hashes any string
+ *  at runtime into the same value
+ */
+#define HASH_NAME_MAX_LENGTH 64
+#define HASH_NAME_PRIME      UINT64_C(0x100000001b3)
+
+#define _HASH_NAME_CHARACTER(Name, Index)                                   \
+((Index) < sizeof(Name) - 1 ?                                               \
+    (uint64_t)(uint8_t)(Name)[(Index) < sizeof(Name) ? (Index) : 0] : 0)
+
+#define _HASH_NAME_STEP(Hash, Name, Index) \
+((Hash) * HASH_NAME_PRIME + _HASH_NAME_CHARACTER(Name, Index))
+
+#define _HASH_NAME_STEP_8(Hash, Name, Base)                                    \
+_HASH_NAME_STEP(_HASH_NAME_STEP(_HASH_NAME_STEP(_HASH_NAME_STEP(               \
+_HASH_NAME_STEP(_HASH_NAME_STEP(_HASH_NAME_STEP(_HASH_NAME_STEP(Hash,          \
+    Name, (Base)), Name, (Base) + 1), Name, (Base) + 2), Name, (Base) + 3),    \
+    Name, (Base) + 4), Name, (Base) + 5), Name, (Base) + 6), Name, (Base) + 7)
+
+#define _HASH_NAME_STEP_64(Hash, Name)                                         \
+_HASH_NAME_STEP_8(_HASH_NAME_STEP_8(_HASH_NAME_STEP_8(_HASH_NAME_STEP_8(       \
+_HASH_NAME_STEP_8(_HASH_NAME_STEP_8(_HASH_NAME_STEP_8(_HASH_NAME_STEP_8(Hash,  \
+    Name, 0), Name, 8), Name, 16), Name, 24), Name, 32), Name, 40), Name, 48), \
+    Name, 56)
+
+/* `Name` must be a string literal */
+#define HASH_NAME(Name) \
+(_HASH_NAME_STEP_64(UINT64_C(0xcbf29ce484222325), Name) ^ (uint64_t)(sizeof(Name) - 1))
+
+uint64_t HashName(const char* Name);
+
+/*                      Hash index
+ * Maps 64 bit keys (usually hashes) into non NULL values with O(1) lookups.
+ * Open addressing with linear probing, grown when over 3/4 full
+ */
+TYPE_STRUCT(HASH_INDEX_ENTRY) {
+    uint64_t Key;
+    // NULL if the entry is free
+    void*    Value;
+};
+
+TYPE_STRUCT(HASH_INDEX) {
+    // Always a power of 2
+    size_t            Capacity;
+    size_t            Length;
+    HASH_INDEX_ENTRY* Entries;
+};
+
+/* Allocate an index that holds `ExpectedLength` keys without growing */
+HASH_INDEX* AllocateHashIndex(size_t ExpectedLength);
+
+/* Map `Key` into `Value`
+ * Returns FALSE (and keeps the previous value) if `Key` is already present
+ */
+BOOLEAN HashIndexInsert(HASH_INDEX* Index, uint64_t Key, void* Value);
+
+/* Returns the value of `Key`, or NULL if it isn't present */
+void* HashIndexFind(const HASH_INDEX* Index, uint64_t Key);
+
+void FreeHashIndex(HASH_INDEX* Index);
+
+#endif /* HASH_INDEX_H */
@@ -3,18 +3,72 @@
 
 #include "BasicList.h"
 #include "Common.h"
+#include "HashIndex.h"
 #include <stdint.h>
 #include <pthread.h> 
 
 #define BEFORE_MAIN __attribute__ ((constructor))
 
+/* Amount of worker threads running background handlers */
+#ifndef INIT_BACKGROUND_WORKERS
+#define INIT_BACKGROUND_WORKERS 2
+#endif
+
 typedef void (*CONSTRUCTOR_HANDLER)(void);
 
+/* Handlers and dependencies are identified by 64 bit IDs: the hash of their
+ *  name for named handlers, their address otherwise
+ */
+#define HANDLER_ID(Handler) ((uint64_t)(uintptr_t)(Handler))
+#define HANDLER_NAME_ID(Name) HASH_NAME(Name)
+
+/* Produce the state a handler initialized, to be stored in the snapshot
+ * Return a Malloc'd OPAQUE_MEMORY* (e.g. from AllocateOpaqueMemory), the
+ *  library takes over both it and its' data. Returning NULL leaves the handler
+ *  out of the snapshot
+ */
+typedef OPAQUE_MEMORY* (*SNAPSHOT_SAVE_HANDLER)(void);
+
+/* Recover the state a handler initialized from the snapshot
+ * `State` is freed once initialization finishes, copy anything that is kept
+ * Returning FALSE makes the handler run instead
+ */
+typedef BOOLEAN (*SNAPSHOT_RESTORE_HANDLER)(OPAQUE_MEMORY* State);
+
+/* Handler behaviour modifiers */
+typedef enum {
+    InitForeground = 0,
+    // Handler may still be running after RunInitializationFunctions returns
+    InitBackground = 1 << 0,
+    // Handler runs in each process forked from a zygote instead of the zygote
+    InitPostFork   = 1 << 1
+}INIT_FLAGS;
+
 TYPE_STRUCT(INIT_INFORMATION) {
+    // Link in the (intrusive) list of registered handlers
+    NO_DATA_ELEMENT Link;
     CONSTRUCTOR_HANDLER Handler;
+    // IDs (uint64_t) of the handlers this one depends on
     OPAQUE_MEMORY* Dependencies;
-    // how many dependencies are still unfullfilled
-    size_t PendingDependencies;
+    // TRUE while the dependencies of this handler are being ordered
+    BOOLEAN Visiting;
+    // INIT_FLAGS for this handler
+    uint32_t Flags;
+    // TRUE once the handler was placed in the run order
+    BOOLEAN Ordered;
+    // TRUE once the handler ran (protected by the background lock)
+    BOOLEAN Completed;
+    // TRUE if the handler is needed by the targets of the current pass
+    BOOLEAN Targeted;
+    // Optional snapshot hooks
+    SNAPSHOT_SAVE_HANDLER    SaveState;
+    SNAPSHOT_RESTORE_HANDLER RestoreState;
+    // View over this handlers' state in the loaded snapshot (NULL Data if none)
+    OPAQUE_MEMORY SnapshotState;
+    // TRUE if the state was recovered instead of running the handler
+    BOOLEAN Restored;
+    // Nanoseconds it took to run (or restore) the handler
+    uint64_t Duration;
     // debug purposes
     char* Location;
 };
@@ -23,23 +77,182 @@ TYPE_STRUCT(INIT_INFORMATION) {
 void RegisterConstructor(const char Location[], CONSTRUCTOR_HANDLER Handler,
                          OPAQUE_MEMORY Dependencies);
 
-#define REGISTER_DEPENDENT_CONSTRUCTOR(Handler, ...)                              \
+/* Register a constructor with the provided INIT_FLAGS */
+void RegisterFlaggedConstructor(const char Location[],
+                                CONSTRUCTOR_HANDLER Handler,
+                                OPAQUE_MEMORY Dependencies, uint32_t Flags);
+
+/* Register a constructor under `NameID` (see HANDLER_NAME_ID), with the
+ *  `Dependencies` IDs it depends on
+ * Named handlers can also be depended on through their address
+ */
+void RegisterNamedConstructor(const char Location[], uint64_t NameID,
+                              CONSTRUCTOR_HANDLER Handler,
+                              OPAQUE_MEMORY Dependencies, uint32_t Flags);
+
+#define _REGISTER_DEPENDENT_CONSTRUCTOR(Flags, Handler, ...)                      \
 static void BEFORE_MAIN GLUE1(RegisterConstructor, __COUNTER__)(void) {           \
-    RegisterConstructor(                                                          \
+    RegisterFlaggedConstructor(                                                   \
       STR(Handler) "(void) from " __FILE__, Handler,                              \
-      (OPAQUE_MEMORY){COUNT_ARGUMENTS(__VA_ARGS__) * sizeof(CONSTRUCTOR_HANDLER), \
-                      FALSE, (void*[]){__VA_ARGS__}});                            \
+      CLOAK_MEMORY(COUNT_ARGUMENTS(__VA_ARGS__) * sizeof(CONSTRUCTOR_HANDLER),    \
+                   FALSE, ((void*[]){__VA_ARGS__})), Flags);                      \
 }
 
-#define REGISTER_INDEPENDENT_CONSTRUCTOR(Handler)                       \
+#define _REGISTER_INDEPENDENT_CONSTRUCTOR(Flags, Handler)               \
 static void BEFORE_MAIN GLUE1(RegisterConstructor, __COUNTER__)(void) { \
-    RegisterConstructor(                                                \
+    RegisterFlaggedConstructor(                                         \
       STR(Handler) "(void) from " __FILE__, Handler,                    \
-      (OPAQUE_MEMORY){0, FALSE, NULL});                                 \
+      CLOAK_MEMORY(0, FALSE, NULL), Flags);                             \
+}
+
+#define REGISTER_DEPENDENT_CONSTRUCTOR(Handler, ...) \
+        _REGISTER_DEPENDENT_CONSTRUCTOR(InitForeground, Handler, __VA_ARGS__)
+
+#define REGISTER_INDEPENDENT_CONSTRUCTOR(Handler) \
+        _REGISTER_INDEPENDENT_CONSTRUCTOR(InitForeground, Handler)
+
+/* Background handlers run on worker threads and don't delay the return of
+ * RunInitializationFunctions. Use WaitForInitialization before relying on them
+ */
+#define REGISTER_DEPENDENT_BACKGROUND_CONSTRUCTOR(Handler, ...) \
+        _REGISTER_DEPENDENT_CONSTRUCTOR(InitBackground, Handler, __VA_ARGS__)
+
+#define REGISTER_INDEPENDENT_BACKGROUND_CONSTRUCTOR(Handler) \
+        _REGISTER_INDEPENDENT_CONSTRUCTOR(InitBackground, Handler)
+
+/* Named handlers are registered and depended on through a string literal name,
+ *  hashed at build time. Modules only need to agree on the names, not on
+ *  each others' symbols
+ */
+#define _REGISTER_NAMED_DEPENDENT_CONSTRUCTOR(Flags, Name, Handler, ...)         \
+static void BEFORE_MAIN GLUE1(RegisterConstructor, __COUNTER__)(void) {          \
+    static const uint64_t Dependencies[] = { APPLY_EACH(HANDLER_NAME_ID,         \
+                                                        __VA_ARGS__) };          \
+    _Static_assert(sizeof(Name) <= HASH_NAME_MAX_LENGTH + 1, "Name too long");  \
+    RegisterNamedConstructor(                                                    \
+      Name " (" STR(Handler) ") from " __FILE__, HANDLER_NAME_ID(Name), Handler, \
+      CLOAK_MEMORY(sizeof(Dependencies), FALSE, (void*)Dependencies), Flags);    \
+}
+
+#define _REGISTER_NAMED_INDEPENDENT_CONSTRUCTOR(Flags, Name, Handler)            \
+static void BEFORE_MAIN GLUE1(RegisterConstructor, __COUNTER__)(void) {          \
+    _Static_assert(sizeof(Name) <= HASH_NAME_MAX_LENGTH + 1, "Name too long");  \
+    RegisterNamedConstructor(                                                    \
+      Name " (" STR(Handler) ") from " __FILE__, HANDLER_NAME_ID(Name), Handler, \
+      CLOAK_MEMORY(0, FALSE, NULL), Flags);                                      \
+}
+
+#define REGISTER_NAMED_DEPENDENT_CONSTRUCTOR(Name, Handler, ...) \
+        _REGISTER_NAMED_DEPENDENT_CONSTRUCTOR(InitForeground, Name, Handler, __VA_ARGS__)
+
+#define REGISTER_NAMED_INDEPENDENT_CONSTRUCTOR(Name, Handler) \
+        _REGISTER_NAMED_INDEPENDENT_CONSTRUCTOR(InitForeground, Name, Handler)
+
+#define REGISTER_NAMED_DEPENDENT_BACKGROUND_CONSTRUCTOR(Name, Handler, ...) \
+        _REGISTER_NAMED_DEPENDENT_CONSTRUCTOR(InitBackground, Name, Handler, __VA_ARGS__)
+
+#define REGISTER_NAMED_INDEPENDENT_BACKGROUND_CONSTRUCTOR(Name, Handler) \
+        _REGISTER_NAMED_INDEPENDENT_CONSTRUCTOR(InitBackground, Name, Handler)
+
+/* Post fork handlers set up per process state (threads, sockets, seeds, ...).
+ * When forking workers from a zygote (Zygote.h) they run in each worker.
+ *  Otherwise they run like any other handler
+ */
+#define REGISTER_DEPENDENT_POST_FORK_CONSTRUCTOR(Handler, ...) \
+        _REGISTER_DEPENDENT_CONSTRUCTOR(InitPostFork, Handler, __VA_ARGS__)
+
+#define REGISTER_INDEPENDENT_POST_FORK_CONSTRUCTOR(Handler) \
+        _REGISTER_INDEPENDENT_CONSTRUCTOR(InitPostFork, Handler)
+
+#define REGISTER_NAMED_DEPENDENT_POST_FORK_CONSTRUCTOR(Name, Handler, ...) \
+        _REGISTER_NAMED_DEPENDENT_CONSTRUCTOR(InitPostFork, Name, Handler, __VA_ARGS__)
+
+#define REGISTER_NAMED_INDEPENDENT_POST_FORK_CONSTRUCTOR(Name, Handler) \
+        _REGISTER_NAMED_INDEPENDENT_CONSTRUCTOR(InitPostFork, Name, Handler)
+
+/* Register snapshot hooks for `Handler` */
+void RegisterConstructorSnapshot(CONSTRUCTOR_HANDLER Handler,
+                                 SNAPSHOT_SAVE_HANDLER Save,
+                                 SNAPSHOT_RESTORE_HANDLER Restore);
+
+/* When a snapshot is in use, `Restore` is called instead of `Handler` if the
+ *  snapshot was taken by the same build and has state for `Handler`
+ */
+#define REGISTER_CONSTRUCTOR_SNAPSHOT(Handler, Save, Restore)         \
+static void BEFORE_MAIN GLUE1(RegisterSnapshot, __COUNTER__)(void) { \
+    RegisterConstructorSnapshot(Handler, Save, Restore);             \
 }
 
+/* Use the snapshot file at `Path` (or stop using one if NULL)
+ * Must be called before RunInitializationFunctions. The snapshot is rewritten
+ *  whenever a handler with snapshot hooks had to run. With background handlers
+ *  that happens in WaitForBackgroundInitialization
+ */
+void SetInitializationSnapshot(const char* Path);
+
+/* Run all handlers in dependency order.
+ * Returns once every foreground handler ran. Background handlers may still be
+ *  running on worker threads
+ * Dependency cycles and unregistered dependencies are logged and abort()
+ */
 void RunInitializationFunctions(void);
 
+/* Run all handlers except post fork ones, waiting for background handlers too.
+ * Handlers that aren't post fork must not depend on post fork ones
+ */
+void RunForkSafeInitializationFunctions(void);
+
+/* In a process forked after RunForkSafeInitializationFunctions, run the post
+ *  fork handlers. Without a fork safe pass before, all handlers run. Either
+ *  way the snapshot is neither loaded nor saved
+ */
+void RunPostForkInitializationFunctions(void);
+
+/* Release the handlers without running the ones still pending */
+void ReleaseInitializationFunctions(void);
+
+/* Write how long each handler took into the file at `Path` (or stop if NULL)
+ *  once initialization finishes. One "<microseconds>\t<location>" line per
+ *  handler, which SimulateInitialization reads back
+ */
+void SetInitializationProfile(const char* Path);
+
+/* Tool mode, used instead of RunInitializationFunctions: report how long
+ *  initialization takes on `Cores` cores (0 for all online cores) under each
+ *  scheduling policy, its' critical path and the dependencies worth breaking
+ * Durations are read from the profile at `DurationsPath` (handlers don't run
+ *  and missing ones take no time) or, if NULL, measured by running the handlers
+ */
+void SimulateInitialization(const char* DurationsPath, uint32_t Cores);
+
+/* Run, in order, only the handlers with the `Targets` IDs and the ones they
+ *  (transitively) depend on, including background ones. The other handlers
+ *  stay registered for a later call
+ */
+void RunInitializationFunctionsForIDs(const uint64_t* Targets, size_t TargetAmmount);
+
+/* RunInitializationFunctionsFor(Handler1, Handler2, ...) (up to 9 handlers) */
+#define RunInitializationFunctionsFor(...)                                          \
+RunInitializationFunctionsForIDs((const uint64_t[]){ APPLY_EACH(HANDLER_ID, __VA_ARGS__) }, \
+                                 COUNT_ARGUMENTS(__VA_ARGS__))
+
+/* RunNamedInitializationFunctionsFor("name1", "name2", ...) (up to 9 names) */
+#define RunNamedInitializationFunctionsFor(...)                                     \
+RunInitializationFunctionsForIDs((const uint64_t[]){                                \
+                                   APPLY_EACH(HANDLER_NAME_ID, __VA_ARGS__) },      \
+                                 COUNT_ARGUMENTS(__VA_ARGS__))
+
+/* Block until `Handler` ran. Returns immediately for foreground handlers and
+ *  when no background initialization is in progress
+ */
+void WaitForInitialization(CONSTRUCTOR_HANDLER Handler);
+
+/* Same as WaitForInitialization, for the handler registered as `Name` */
+void WaitForNamedInitialization(const char* Name);
+
+/* Block until all background handlers ran and release their resources */
+void WaitForBackgroundInitialization(void);
+
 void MyConstructor1(void);
 void MyConstructor2(void);
 void MyConstructor3(void);
@@ -48,4 +261,4 @@ void MyConstructor3(void);
 #define Constructor2ID MyConstructor2
 #define Constructor3ID MyConstructor3
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,48 @@
+#ifndef INIT_SIMULATION_H
+#define INIT_SIMULATION_H
+
+#include <stdint.h>
+#include "Opaque.h"
+
+/*                      Initialization makespan simulation
+ * Handlers are simulated as non preemptible tasks on identical cores: a
+ *  handler starts once all its' dependencies finished and a core is free.
+ *  When several handlers are ready, the policy picks which one starts first
+ */
+
+TYPE_STRUCT(SIMULATED_HANDLER) {
+    // debug purposes
+    const char*   Location;
+    // nanoseconds
+    uint64_t      Duration;
+    // Indexes (size_t) of the handlers this one depends on. Handlers are kept
+    //  in dependency order, so they are always lower than its' own
+    OPAQUE_MEMORY Dependencies;
+};
+
+typedef enum {
+    // Dependency order, as the background workers pick handlers
+    SimulateInOrder,
+    // Longest remaining path to the end first
+    SimulateCriticalPathFirst,
+    SimulateLongestFirst,
+    SimulateShortestFirst,
+    SimulationPolicyAmmount
+}SIMULATION_POLICY;
+
+/* Time until every handler finished, with `Cores` cores and `Policy` */
+uint64_t SimulateMakespan(const SIMULATED_HANDLER* Handlers, size_t Ammount,
+                          uint32_t Cores, SIMULATION_POLICY Policy);
+
+/* Length of the longest dependency chain. If `Path` isn't NULL it is set up
+ *  with the indexes (size_t) of the handlers in that chain, in order
+ */
+uint64_t CriticalPath(const SIMULATED_HANDLER* Handlers, size_t Ammount,
+                      OPAQUE_MEMORY* Path);
+
+/* Print makespans per policy, the critical path and the dependencies of the
+ *  critical path whose removal shortens the makespan the most
+ */
+void ReportSimulation(SIMULATED_HANDLER* Handlers, size_t Ammount, uint32_t Cores);
+
+#endif /* INIT_SIMULATION_H */
@@ -0,0 +1,68 @@
+#ifndef LIST_PARALLEL_H
+#define LIST_PARALLEL_H
+
+#include "BasicList.h"
+
+/* Maximum amount of threads in the shared pool (besides the calling thread) */
+#ifndef LIST_PARALLEL_MAX_WORKERS
+#define LIST_PARALLEL_MAX_WORKERS 63
+#endif
+
+/* The pool has one thread per core (minus the calling thread) unless
+ *  LIST_PARALLEL_WORKERS is defined
+ */
+
+/* Parallel algorithms over Data and Memory lists
+ *
+ * `Element` always points to the element payload: an OPAQUE_DATA* for Data
+ *  lists and an OPAQUE_MEMORY* for Memory lists (intrusive lists aren't
+ *  supported)
+ * The list is split into chunks of `GrainSize` elements (0 picks a size from
+ *  the list length) which run on a shared, work stealing, thread pool
+ * The list must not be modified while an algorithm runs on it. Calls made from
+ *  inside a handler run sequentially
+ */
+
+typedef void (*LIST_FOR_EACH_HANDLER)(void* Element, void* Context);
+
+/* Write the result for `Element` into `Output` */
+typedef void (*LIST_MAP_HANDLER)(const void* Element, void* Output,
+                                 void* Context);
+
+/* Return the new memory for `Element` */
+typedef OPAQUE_MEMORY (*LIST_MEMORY_MAP_HANDLER)(const void* Element,
+                                                 void* Context);
+
+/* Accumulate `Element` into `Accumulator` */
+typedef void (*LIST_REDUCE_HANDLER)(void* Accumulator, const void* Element,
+                                    void* Context);
+
+/* Accumulate the result of a chunk (`Partial`) into `Accumulator` */
+typedef void (*LIST_COMBINE_HANDLER)(void* Accumulator, const void* Partial,
+                                     void* Context);
+
+/* Call `Handler` for every element of `List` */
+void ListParallelForEach(LIST* List, LIST_FOR_EACH_HANDLER Handler,
+                         void* Context, size_t GrainSize);
+
+/* Map every element of `List` into an array of `OutputSize` byte results
+ * The result for the Nth element is at offset N * `OutputSize`
+ */
+OPAQUE_MEMORY* ListParallelMap(LIST* List, size_t OutputSize,
+                               LIST_MAP_HANDLER Handler, void* Context,
+                               size_t GrainSize);
+
+/* Map every element of `List` into a new Memory list, in the same order */
+LIST* ListParallelMapToMemoryList(LIST* List, LIST_MEMORY_MAP_HANDLER Handler,
+                                  void* Context, size_t GrainSize);
+
+/* Reduce `List` into `Accumulator`
+ * `Accumulator` must hold the identity value (`AccumulatorSize` bytes) which
+ *  every chunk starts from. Chunk results are combined in list order, so
+ *  `Combine` only needs to be associative
+ */
+void ListParallelReduce(LIST* List, void* Accumulator, size_t AccumulatorSize,
+                        LIST_REDUCE_HANDLER Reduce, LIST_COMBINE_HANDLER Combine,
+                        void* Context, size_t GrainSize);
+
+#endif /* LIST_PARALLEL_H */
@@ -0,0 +1,70 @@
+#ifndef LIST_SORT_H
+#define LIST_SORT_H
+
+#include "BasicList.h"
+
+/* Ordering operations over lists
+ *
+ * Elements are relinked in place, never copied or reallocated, so pointers to
+ *  elements stay valid
+ * `Left` and `Right` point to the element payload: an OPAQUE_DATA* for Data
+ *  lists, an OPAQUE_MEMORY* for Memory lists and the NO_DATA_ELEMENT link
+ *  (use CONTAINER_OF) for intrusive lists
+ * Comparisons return a negative value, 0 or a positive value like memcmp
+ */
+typedef int (*LIST_COMPARE_HANDLER)(const void* Left, const void* Right,
+                                    void* Context);
+
+/* Comparisons of OPAQUE_DATA as uintptr_t and intptr_t */
+int CompareUnsignedData(const void* Left, const void* Right, void* Context);
+int CompareSignedData(const void* Left, const void* Right, void* Context);
+
+/* Comparison of OPAQUE_MEMORY with CompareOpaqueMemory */
+int CompareMemoryData(const void* Left, const void* Right, void* Context);
+
+/*                      Sorting
+ * Stable bottom-up merge sort, O(n log n) comparisons
+ * SortDataList copies the payloads of longer lists, with their' links, into a
+ *  scratch array (32 bytes per element on 64 bit) which is sorted and then
+ *  relinked, so comparisons don't chase scattered links. If it can't be
+ *  allocated, and for the other lists, links are merged directly with O(1)
+ *  extra space
+ */
+void SortDataList(LIST* List, LIST_COMPARE_HANDLER Compare, void* Context);
+void SortMemoryList(LIST* List, LIST_COMPARE_HANDLER Compare, void* Context);
+void SortIntrusiveList(LIST* List, LIST_COMPARE_HANDLER Compare, void* Context);
+
+/* Stable sort of a Data list by the value of its' elements (as intptr_t if
+ *  `Signed`, as uintptr_t otherwise)
+ * A first walk finds the key bytes that differ between elements. When only
+ *  one does, it's a single LSD radix pass over that byte; otherwise it's SortDataList with CompareSignedData/CompareUnsignedData
+ *  (the walk stops as soon as that is known)
+ */
+void RadixSortDataList(LIST* List, BOOLEAN Signed);
+
+/*                      Sorted lists
+ * Both lists must already be sorted by `Compare`
+ */
+
+/* Move every element of `From` into `Into`, keeping `Into` sorted
+ * Equal elements of `Into` stay before those of `From`. `From` is left empty
+ */
+void MergeSortedDataLists(LIST* Into, LIST* From, LIST_COMPARE_HANDLER Compare,
+                          void* Context);
+void MergeSortedMemoryLists(LIST* Into, LIST* From, LIST_COMPARE_HANDLER Compare,
+                            void* Context);
+void MergeSortedIntrusiveLists(LIST* Into, LIST* From,
+                               LIST_COMPARE_HANDLER Compare, void* Context);
+
+/* Keep only the first of each run of equal elements
+ * Returns the amount of elements removed. Removed Data and Memory elements are
+ *  freed, removed intrusive links are only unlinked
+ */
+size_t DedupSortedDataList(LIST* List, LIST_COMPARE_HANDLER Compare,
+                           void* Context);
+size_t DedupSortedMemoryList(LIST* List, LIST_COMPARE_HANDLER Compare,
+                             void* Context);
+size_t DedupSortedIntrusiveList(LIST* List, LIST_COMPARE_HANDLER Compare,
+                                void* Context);
+
+#endif /* LIST_SORT_H */
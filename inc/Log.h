@@ -0,0 +1,135 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "Common.h"
+
+/*                      Deferred logging
+ * Logging only copies the format (which must be a string literal) and its'
+ *  arguments into a lock-free ring owned by the calling thread. Formatting
+ *  and output happen in FlushLog, called explicitly, by the background
+ *  drainer or at exit
+ * Error records are flushed right away
+ * Supported arguments: integers, floating point, strings (copied, possibly
+ *  truncated) and pointers. At most 9 per record. `*` widths aren't supported
+ */
+
+#define LOG_LEVEL_DEBUG   0
+#define LOG_LEVEL_INFO    1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR   3
+#define LOG_LEVEL_NONE    4
+
+/* Records below LOG_LEVEL are removed at compile time */
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+/* Records each thread can hold before new ones are dropped (power of 2) */
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 256
+#endif
+
+/* Space for the strings of a record, including their terminators */
+#define LOG_STRING_SPACE 160
+
+#define LOG_MAX_ARGUMENTS 9
+
+typedef enum {
+    LogSigned,
+    LogUnsigned,
+    LogReal,
+    LogString,
+    LogPointer
+}LOG_ARGUMENT_TYPE;
+
+TYPE_STRUCT(LOG_ARGUMENT) {
+    LOG_ARGUMENT_TYPE Type;
+    union {
+        int64_t     Signed;
+        uint64_t    Unsigned;
+        double      Real;
+        const char* String;
+        const void* Pointer;
+    };
+};
+
+static inline LOG_ARGUMENT LogSignedArgument(int64_t Value) {
+    return (LOG_ARGUMENT){ .Type = LogSigned, .Signed = Value };
+}
+static inline LOG_ARGUMENT LogUnsignedArgument(uint64_t Value) {
+    return (LOG_ARGUMENT){ .Type = LogUnsigned, .Unsigned = Value };
+}
+static inline LOG_ARGUMENT LogRealArgument(double Value) {
+    return (LOG_ARGUMENT){ .Type = LogReal, .Real = Value };
+}
+static inline LOG_ARGUMENT LogStringArgument(const char* Value) {
+    return (LOG_ARGUMENT){ .Type = LogString, .String = Value };
+}
+static inline LOG_ARGUMENT LogPointerArgument(const void* Value) {
+    return (LOG_ARGUMENT){ .Type = LogPointer, .Pointer = Value };
+}
+
+#define LOG_ARGUMENT_OF(Value) _Generic((Value),                            \
+    char*: LogStringArgument, const char*: LogStringArgument,               \
+    float: LogRealArgument, double: LogRealArgument,                        \
+    long double: LogRealArgument,                                           \
+    _Bool: LogUnsignedArgument, unsigned char: LogUnsignedArgument,         \
+    unsigned short: LogUnsignedArgument, unsigned int: LogUnsignedArgument, \
+    unsigned long: LogUnsignedArgument,                                     \
+    unsigned long long: LogUnsignedArgument,                                \
+    char: LogSignedArgument, signed char: LogSignedArgument,                \
+    short: LogSignedArgument, int: LogSignedArgument,                       \
+    long: LogSignedArgument, long long: LogSignedArgument,                  \
+    default: LogPointerArgument)(Value)
+
+/* Queue a record. Use the LOG_<LEVEL> macros instead */
+void LogRecord(int Level, const char* Format, size_t ArgumentAmmount,
+               const LOG_ARGUMENT* Arguments);
+
+#define LOG(Level, Format, ...)                                             \
+LogRecord(Level, Format, COUNT_ARGUMENTS(__VA_ARGS__),                      \
+          (LOG_ARGUMENT[]){ { .Type = LogSigned },                          \
+                            APPLY_EACH(LOG_ARGUMENT_OF, __VA_ARGS__) } + 1)
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(Format, ...) LOG(LOG_LEVEL_DEBUG, Format, ## __VA_ARGS__)
+#else
+#define LOG_DEBUG(Format, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(Format, ...) LOG(LOG_LEVEL_INFO, Format, ## __VA_ARGS__)
+#else
+#define LOG_INFO(Format, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARNING
+#define LOG_WARNING(Format, ...) LOG(LOG_LEVEL_WARNING, Format, ## __VA_ARGS__)
+#else
+#define LOG_WARNING(Format, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(Format, ...) LOG(LOG_LEVEL_ERROR, Format, ## __VA_ARGS__)
+#else
+#define LOG_ERROR(Format, ...) ((void)0)
+#endif
+
+/* Format and write every queued record, oldest first */
+void FlushLog(void);
+
+/* Where records are written to (stdout by default) */
+void SetLogOutput(FILE* Output);
+
+/* Flush the log from a background thread every `IntervalMilliseconds` */
+void StartLogDrainer(uint32_t IntervalMilliseconds);
+
+/* Stop the background thread and flush whatever is left */
+void StopLogDrainer(void);
+
+/* Amount of records dropped because their' thread's ring was full */
+uint64_t GetDroppedLogRecords(void);
+
+#endif /* LOG_H */
@@ -33,45 +33,108 @@ typedef union{
 #define GENERIC_DATA(Type, Data) \
 (OPAQUE_DATA){ .GLUE(Val_, Type) = Data}
 
+/* Memory up to this size is stored inside OPAQUE_MEMORY itself */
+#ifndef OPAQUE_INLINE_SIZE
+#define OPAQUE_INLINE_SIZE (3 * sizeof(void*))
+#endif
+
 /* Struct for generic memory manipulation */
 TYPE_STRUCT(OPAQUE_MEMORY){
     size_t  Size;
     // If TRUE, Data contains a pointer that can be freed
     BOOLEAN Allocated;
-    // If != NULL, contains a pointer to an alocated arena of size `Size`
-    void*   Data;
+    // If TRUE, the memory is stored in InlineData and Data must not be used
+    BOOLEAN Inline;
+    // If TRUE, Data points into a reference counted block that may be shared
+    //  with other OPAQUE_MEMORY and must not be written to directly
+    BOOLEAN Shared;
+    union {
+        // If != NULL, contains a pointer to an alocated arena of size `Size`
+        void*   Data;
+        uint8_t InlineData[OPAQUE_INLINE_SIZE];
+    };
 };
 
-#define CAST_MEMORY_AS(Mem, Type) ((Type*)((Mem)->Data))
+/* Address of the memory held by an OPAQUE_MEMORY, wherever it is stored */
+#define OPAQUE_MEMORY_DATA(Mem) \
+((Mem)->Inline == TRUE ? (void*)((Mem)->InlineData) : (Mem)->Data)
+
+#define CAST_MEMORY_AS(Mem, Type) ((Type*)OPAQUE_MEMORY_DATA(Mem))
+
+/* Same as CAST_MEMORY_AS, but safe to write to when the memory is shared */
+#define CAST_WRITABLE_MEMORY_AS(Mem, Type) ((Type*)GetWritableOpaqueMemory(Mem))
 
 /* Encapsulate static data into an OPAQUE_MEMORY struct */
-#define CLOAK_MEMORY(Size, Alloc, Data) \
-((OPAQUE_MEMORY){Size, Alloc, Data})
+#define CLOAK_MEMORY(_Size, Alloc, _Data) \
+((OPAQUE_MEMORY){.Size = (_Size), .Allocated = (Alloc), .Inline = FALSE, \
+                .Shared = FALSE, .Data = (_Data)})
 
-#define CLOAK_STRUCT(StructName, Data, Alloc) \
-((OPAQUE_MEMORY){siezof(StructName), Alloc, Data})
+#define CLOAK_STRUCT(StructName, _Data, Alloc) \
+CLOAK_MEMORY(sizeof(StructName), Alloc, _Data)
 
-#define CLOAK_LIST(Size, ...) \
-{Size, FALSE, (uint8_t[]){__VA_ARGS__} }
+#define CLOAK_LIST(_Size, ...) \
+{.Size = (_Size), .Allocated = FALSE, .Inline = FALSE, .Data = (uint8_t[]){__VA_ARGS__} }
 
-#define ITERATE_INDEXED_MEMORY(Mem, Type, Var, Ind)     \
-for ((Ind = 0, Var = (Type*)((Mem)->Data));             \
+/* Iterate `Mem` as consecutive views of (up to) `SliceSize` bytes
+ * `Mem` and `SliceSize` are evaluated once. `SliceSize` must not be 0 (nothing
+ *  is iterated then)
+ */
+#define ITERATE_SLICES(Mem, SliceSize, Var)                                 \
+for (struct { OPAQUE_MEMORY* Memory; size_t Size; size_t Offset; }          \
+        Slices = { (Mem), (SliceSize), 0 };                                 \
+        (SANITY_CHECK( Assert(Slices.Size != 0), ) Slices.Size != 0) &&     \
+        (Slices.Offset < Slices.Memory->Size) &&                            \
+        ((Var) = SliceOpaqueMemory(Slices.Memory, Slices.Offset,            \
+                   (Slices.Memory->Size - Slices.Offset < Slices.Size) ?    \
+                   Slices.Memory->Size - Slices.Offset : Slices.Size), 1);  \
+    Slices.Offset += Slices.Size)
+
+#define ITERATE_INDEXED_MEMORY(Mem, Type, Var, Ind)         \
+for ((Ind = 0, Var = (Type*)OPAQUE_MEMORY_DATA(Mem));       \
       Ind != (Mem)->Size;                       \
       Var += sizeof(Type))
 
 #define ITERATE_MEMORY(Mem, Type, Var)                                      \
-for (Var = (Type*)((Mem)->Data); Var != (Type*)((Mem)->Data) + (Mem)->Size; \
+for (Var = (Type*)OPAQUE_MEMORY_DATA(Mem);                                  \
+     Var != (Type*)OPAQUE_MEMORY_DATA(Mem) + (Mem)->Size;                   \
      Var += sizeof(Type))
 
 /* Setup new memory for the provided `Memory`.
- * Allocates `Size` bytes from generic memory
+ * Allocates `Size` bytes from generic memory, or stores them inline if they fit
  */
 void SetupOpaqueMemory(OPAQUE_MEMORY* Opaque, size_t Size);
 
+/* Setup new reference counted memory for the provided `Memory` */
+void SetupSharedOpaqueMemory(OPAQUE_MEMORY* Opaque, size_t Size);
+
+/* Return a new reference to the memory in `Opaque`, without copying it
+ * `Opaque` is first moved into a reference counted block if it isn't shared.
+ *  Inline memory is small enough to be copied instead
+ * Clearing a reference only releases the memory if it was the last one
+ */
+OPAQUE_MEMORY ShareOpaqueMemory(OPAQUE_MEMORY* Opaque);
+
+/* Get the address of the memory in `Opaque` for writing
+ * Shared memory that is referenced elsewhere is copied first (copy-on-write)
+ */
+void* GetWritableOpaqueMemory(OPAQUE_MEMORY* Opaque);
+
+/* Non owning view over [`Offset`, `Offset` + `Size`) of `Source`
+ * Nothing is copied. The view is read-only, is never freed by
+ *  ClearOpaqueMemory and is only valid while `Source` holds that memory (and,
+ *  for inline memory, while `Source` isn't moved)
+ */
+OPAQUE_MEMORY SliceOpaqueMemory(OPAQUE_MEMORY* Source, size_t Offset,
+                                size_t Size);
+
+/* Split `Source` into views of [0, `At`) and [`At`, Size) */
+void SplitOpaqueMemory(OPAQUE_MEMORY* Source, size_t At, OPAQUE_MEMORY* Left,
+                       OPAQUE_MEMORY* Right);
+
 /* Allocate a new OPAQUE_MEMORY and set it up */
 OPAQUE_MEMORY* AllocateOpaqueMemory(size_t Size);
 
-/* Free allocated data if (Allocated == True) */
+/* Free allocated data if (Allocated == True), drop the reference if Shared */
 void ClearOpaqueMemory(OPAQUE_MEMORY* Opaque);
 
 /* Clear Opaque structure and release its' memory */
@@ -107,6 +170,9 @@ void AppendOpaqueMemory_3(OPAQUE_MEMORY* Destination, OPAQUE_MEMORY* Source, \
 
 #define AppendMemory(...) GEN_OVERLOAD(AppendMemory, __VA_ARGS__)(__VA_ARGS__)
 
+/* Copy `Ammount` bytes of `Source` into `Destination` with appropriate
+ *  `Offset`. Copying all of a Shared `Source` into `Destination` only shares it
+ */
 void CopyOpaqueMemory_4(OPAQUE_MEMORY* Destination, OPAQUE_MEMORY* Source,
                         int Offset, size_t Ammount);
 void CopyOpaqueMemory_3(OPAQUE_MEMORY* Destination, OPAQUE_MEMORY* Source,
@@ -117,6 +183,34 @@ void CopyOpaqueMemory_2(OPAQUE_MEMORY* Destination, OPAQUE_MEMORY* Source);
         GEN_OVERLOAD(CopyOpaqueMemory, __VA_ARGS__)(__VA_ARGS__)
 
 
+//          Comparison, search and fill (SSE2/AVX2 when available)
+
+/* Returned by searches that found nothing */
+#define OPAQUE_NOT_FOUND SIZE_MAX
+
+/* Order `A` and `B` like memcmp. When one is a prefix of the other, the
+ *  shorter comes first
+ */
+int CompareOpaqueMemory(OPAQUE_MEMORY* A, OPAQUE_MEMORY* B);
+
+BOOLEAN OpaqueMemoryEqual(OPAQUE_MEMORY* A, OPAQUE_MEMORY* B);
+
+/* Index of the first `Byte` at or after `Offset` (or OPAQUE_NOT_FOUND) */
+size_t FindByteInOpaqueMemory(OPAQUE_MEMORY* Memory, uint8_t Byte,
+                              size_t Offset);
+
+/* Index of the first `PatternSize` bytes equal to `Pattern` at or after
+ *  `Offset` (or OPAQUE_NOT_FOUND)
+ */
+size_t FindInOpaqueMemory(OPAQUE_MEMORY* Memory, const void* Pattern,
+                          size_t PatternSize, size_t Offset);
+
+/* Amount of bytes in `Memory` equal to `Byte` */
+size_t CountByteInOpaqueMemory(OPAQUE_MEMORY* Memory, uint8_t Byte);
+
+/* Set every byte of `Memory` to `Byte` */
+void FillOpaqueMemory(OPAQUE_MEMORY* Memory, uint8_t Byte);
+
 #ifdef ENABLE_SANITY_CHECKS
 
 /* Assert Opaque Memory is sane */
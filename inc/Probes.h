@@ -0,0 +1,73 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+#include <stdint.h>
+#include "Common.h"
+
+/*                      USDT static probes
+ * Probes live in the "init" provider and can be attached to by perf, bpftrace,
+ *  etc (e.g. `bpftrace -e 'usdt:./exe:init:handler_end { ... }'`)
+ * When sys/sdt.h is available they are compiled as a single nop each, unless
+ *  DISABLE_USDT_PROBES is defined
+ */
+#if !defined(DISABLE_USDT_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define PROBE(Name, ...) STAP_PROBEV(init, Name, ## __VA_ARGS__)
+#endif
+#endif
+
+#ifndef PROBE
+#define PROBE(Name, ...)
+#endif
+
+/*                      Runtime counters
+ * Process wide totals. Each thread counts into its' own cache line aligned
+ *  block with plain (relaxed, not locked) additions, GetRuntimeCounters sums
+ *  the blocks. Define DISABLE_RUNTIME_COUNTERS to compile them out
+ */
+TYPE_STRUCT(RUNTIME_COUNTERS) {
+    uint64_t ConstructorsRegistered;
+    uint64_t HandlersRun;
+    uint64_t ListInserts;
+    uint64_t ListClears;
+    uint64_t OpaqueAllocations;
+    uint64_t OpaqueFrees;
+    uint64_t OpaqueResizes;
+    uint64_t BytesAllocated;
+    uint64_t BytesCopied;
+};
+
+/* Counters of the calling thread, set up on its' first COUNT */
+extern __thread RUNTIME_COUNTERS* ThreadCounters;
+
+/* Add `Value` to the counter at `Offset` when the calling thread has no block
+ *  of its' own (yet, or anymore once it is exiting)
+ */
+void CountWithoutBlock(size_t Offset, uint64_t Value);
+
+#ifndef DISABLE_RUNTIME_COUNTERS
+// Only the owning thread writes a block, so load + store can't lose counts
+#define COUNT(Field, Value) do {                                              \
+    RUNTIME_COUNTERS* _Counters = ThreadCounters;                             \
+    if (__builtin_expect(_Counters != NULL, 1)) {                             \
+        __atomic_store_n(&(_Counters->Field),                                 \
+                         __atomic_load_n(&(_Counters->Field), __ATOMIC_RELAXED) + \
+                         (uint64_t)(Value), __ATOMIC_RELAXED);                \
+    } else {                                                                  \
+        CountWithoutBlock(offsetof(RUNTIME_COUNTERS, Field), (uint64_t)(Value)); \
+    }                                                                         \
+} while (0)
+#else
+#define COUNT(Field, Value)
+#endif
+
+/* Copy the current counter values into `Counters` */
+void GetRuntimeCounters(RUNTIME_COUNTERS* Counters);
+
+/* Set all counters back to 0
+ * Counts made by other threads at the same time may be kept or lost
+ */
+void ResetRuntimeCounters(void);
+
+#endif /* PROBES_H */
@@ -0,0 +1,41 @@
+#ifndef ZYGOTE_H
+#define ZYGOTE_H
+
+#include <sys/types.h>
+#include "Init.h"
+
+/*                      Fork server (zygote)
+ * A zygote runs every fork safe handler once and then forks pre-initialized
+ *  workers on request. Workers share the initialized memory copy-on-write
+ *  with the zygote and only run the post fork handlers themselves
+ */
+
+/* How long the zygote waits for a request on a new connection before dropping
+ *  it, so a silent client can't stall later requests
+ */
+#ifndef ZYGOTE_REQUEST_TIMEOUT_MS
+#define ZYGOTE_REQUEST_TIMEOUT_MS 1000
+#endif
+
+/* How long clients wait for the zygote to answer */
+#ifndef ZYGOTE_REPLY_TIMEOUT_MS
+#define ZYGOTE_REPLY_TIMEOUT_MS 5000
+#endif
+
+/* Run the fork safe handlers and serve spawn requests on the UNIX socket at
+ *  `SocketPath`
+ * Returns TRUE in each spawned worker, once its' post fork handlers ran (as
+ *  with RunInitializationFunctions, background ones may still be running)
+ * Returns FALSE in the zygote once it is stopped or the socket can't be used
+ */
+BOOLEAN RunInitializationZygote(const char* SocketPath);
+
+/* Ask the zygote at `SocketPath` for a new worker
+ * Returns the workers' pid, or -1 on failure. Workers are reaped by the zygote
+ */
+pid_t SpawnFromZygote(const char* SocketPath);
+
+/* Make the zygote at `SocketPath` stop serving requests */
+BOOLEAN StopZygote(const char* SocketPath);
+
+#endif /* ZYGOTE_H */
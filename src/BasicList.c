@@ -2,6 +2,8 @@
 
 #include "Common.h"
 #include "BasicList.h"
+#include "Probes.h"
+#include "Frame.h"
 
 #ifdef ENABLE_SANITY_CHECKS
 
@@ -53,6 +55,17 @@ void AssertSaneDataList(LIST* List) {
     Assert("Invalid type for data list" == 0);
 }
 
+void AssertSaneIntrusiveList(LIST* List) {
+    AssertSaneList(List);
+    switch (List->InsertedTypes) {
+        case IntrusiveDataType:
+        case NoDataType:
+            return;
+        default:
+    }
+    Assert("Invalid type for intrusive list" == 0);
+}
+
 #endif
 
 LIST* AllocateList(void) {
@@ -80,6 +93,9 @@ static void AddListElement(LIST* List, void* _NewLink) {
         List->Tail = NewLink;
     }
     List->Length += 1;
+
+    PROBE(list_insert, List, List->Length);
+    COUNT(ListInserts, 1);
 }
 
 void MemoryListInsert(LIST* List, OPAQUE_MEMORY NewMemory) {
@@ -104,12 +120,36 @@ void DataListInsert(LIST* List, OPAQUE_DATA NewData) {
     AddListElement(List, NewLink);
 }
 
-OPAQUE_MEMORY* SerializeDataList_2(LIST* List, size_t ElementSize) {
-    SANITY_CHECK( AssertSaneDataList(List) );
+void IntrusiveListInsert(LIST* List, NO_DATA_ELEMENT* Link) {
+    SANITY_CHECK( AssertSaneIntrusiveList(List) );
+    SANITY_CHECK( ValidateInsertion(List, IntrusiveDataType) );
+    SANITY_CHECK( Assert(Link != NULL) );
 
-    OPAQUE_MEMORY* Total = AllocateOpaqueMemory(ElementSize * List->Length);
-    uint8_t* MemoryIndex;
-    MemoryIndex = (uint8_t*)Total->Data;
+    Link->Next = NULL;
+
+    AddListElement(List, Link);
+}
+
+NO_DATA_ELEMENT* IntrusiveListPop(LIST* List) {
+    SANITY_CHECK( AssertSaneIntrusiveList(List) );
+
+    NO_DATA_ELEMENT* Head = List->Head;
+    if (Head == NULL) {
+        return NULL;
+    }
+
+    List->Head = Head->Next;
+    if (List->Head == NULL) {
+        List->Tail = NULL;
+    }
+    List->Length -= 1;
+
+    Head->Next = NULL;
+    return Head;
+}
+
+/* Write the low `ElementSize` bytes of each element of `List` at `MemoryIndex` */
+static void WriteDataList(LIST* List, size_t ElementSize, uint8_t* MemoryIndex) {
     uintptr_t Element;
 
     ITERATE_PRIMITIVE_DATA_TYPE(List, uintptr_t, Element) {
@@ -128,7 +168,13 @@ OPAQUE_MEMORY* SerializeDataList_2(LIST* List, size_t ElementSize) {
         }
         MemoryIndex += ElementSize;
     }
+}
 
+OPAQUE_MEMORY* SerializeDataList_2(LIST* List, size_t ElementSize) {
+    SANITY_CHECK( AssertSaneDataList(List) );
+
+    OPAQUE_MEMORY* Total = AllocateOpaqueMemory(ElementSize * List->Length);
+    WriteDataList(List, ElementSize, OPAQUE_MEMORY_DATA(Total));
     return Total;
 }
 
@@ -137,7 +183,7 @@ OPAQUE_MEMORY* SerializeDataList_1(LIST* List) {
 
     OPAQUE_MEMORY* Total = AllocateOpaqueMemory(sizeof(OPAQUE_DATA) * List->Length);
     uint8_t* MemoryIndex;
-    MemoryIndex = (uint8_t*)Total->Data;
+    MemoryIndex = (uint8_t*)OPAQUE_MEMORY_DATA(Total);
     uintptr_t Element;
 
     ITERATE_PRIMITIVE_DATA_TYPE(List, uintptr_t, Element) {
@@ -150,41 +196,77 @@ OPAQUE_MEMORY* SerializeDataList_1(LIST* List) {
     return Total;
 }
 
-LIST* DeSerializeDataList(OPAQUE_MEMORY* Memory, size_t ElementSize) {
+/* Recover a data list from [`Offset`, `End`) of `Memory`
+ * Returns NULL if the range isn't a whole number of elements
+ */
+static LIST* DeSerializeDataElements(OPAQUE_MEMORY* Memory, size_t Offset,
+                                     size_t End, size_t ElementSize) {
     SANITY_CHECK( AssertSaneOpaqueMemory(Memory) );
 
-    uint8_t* MemoryIndex = Memory->Data;
-    intptr_t Field;
+    if (ElementSize == 0 || ElementSize > sizeof(intptr_t) ||
+        (End - Offset) % ElementSize != 0) {
+        return NULL;
+    }
+
+    uint8_t* MemoryIndex = (uint8_t*)OPAQUE_MEMORY_DATA(Memory) + Offset;
+    uint8_t* MemoryEnd = (uint8_t*)OPAQUE_MEMORY_DATA(Memory) + End;
     LIST* List = AllocateList();
-    while (MemoryIndex < (uint8_t*)Memory->Data + Memory->Size) {
+    while (MemoryIndex != MemoryEnd) {
         // Assume same endianness
+        intptr_t Field = 0;
         Memcpy(&Field, MemoryIndex, ElementSize);
         DataListInsert(List, GENERIC_DATA(intptr_t, Field));
         MemoryIndex += ElementSize;
     }
-    SANITY_CHECK(Assert(MemoryIndex == (uint8_t*)Memory->Data + Memory->Size));
     return List;
 }
 
-LIST* DeSerializeMemoryList(OPAQUE_MEMORY* Memory) {
+LIST* DeSerializeDataList(OPAQUE_MEMORY* Memory, size_t ElementSize) {
+    return DeSerializeDataElements(Memory, 0, Memory->Size, ElementSize);
+}
+
+/* Recover a memory list from [`Offset`, `End`) of `Memory`
+ * Every length field is checked against what is left before it's used, a
+ *  truncated or oversized element fails the whole list with NULL
+ */
+static LIST* DeSerializeMemoryElements(OPAQUE_MEMORY* Memory, size_t Offset,
+                                       size_t End, BOOLEAN Copy) {
     SANITY_CHECK( AssertSaneOpaqueMemory(Memory) );
 
-    uint8_t* MemoryIndex = Memory->Data;
     size_t FieldSize;
     LIST* List = AllocateList();
-    while (MemoryIndex < (uint8_t*)Memory->Data + Memory->Size) {
+    while (Offset != End) {
+        if (End - Offset < sizeof(FieldSize)) {
+            FreeMemoryList(List);
+            return NULL;
+        }
         // Assume same endianness
-        Memcpy(&FieldSize, MemoryIndex, sizeof(FieldSize));
-        MemoryIndex += sizeof(FieldSize);
-        MemoryListInsert(List, DuplicateIntoOpaqueMemory(MemoryIndex, FieldSize));
-        MemoryIndex += FieldSize;
-    }
+        Memcpy(&FieldSize, (uint8_t*)OPAQUE_MEMORY_DATA(Memory) + Offset, sizeof(FieldSize));
+        Offset += sizeof(FieldSize);
+        if (FieldSize > End - Offset) {
+            FreeMemoryList(List);
+            return NULL;
+        }
 
-    SANITY_CHECK( Assert(MemoryIndex == (uint8_t*)Memory->Data + Memory->Size) );
+        OPAQUE_MEMORY Field = SliceOpaqueMemory(Memory, Offset, FieldSize);
+        if (Copy == TRUE) {
+            Field = DuplicateIntoOpaqueMemory(OPAQUE_MEMORY_DATA(&Field), FieldSize);
+        }
+        MemoryListInsert(List, Field);
+        Offset += FieldSize;
+    }
 
     return List;
 }
 
+LIST* DeSerializeMemoryList(OPAQUE_MEMORY* Memory) {
+    return DeSerializeMemoryElements(Memory, 0, Memory->Size, TRUE);
+}
+
+LIST* DeSerializeMemoryListViews(OPAQUE_MEMORY* Memory) {
+    return DeSerializeMemoryElements(Memory, 0, Memory->Size, FALSE);
+}
+
 static size_t SerializedMemoryListSize(LIST* List) {
     SANITY_CHECK( AssertSaneMemoryList(List) );
 
@@ -197,27 +279,99 @@ static size_t SerializedMemoryListSize(LIST* List) {
     return TotalSize;
 }
 
+/* Write the [ Size | Data ] pairs of `List` at `MemoryIndex` */
+static void WriteMemoryList(LIST* List, uint8_t* MemoryIndex) {
+    OPAQUE_MEMORY Element;
+
+    ITERATE_MEMORY_TYPE(List, Element) {
+        Memcpy(MemoryIndex, &(Element.Size), sizeof(Element.Size));
+        MemoryIndex += sizeof(Element.Size);
+        Memcpy(MemoryIndex, OPAQUE_MEMORY_DATA(&Element), Element.Size);
+        MemoryIndex += Element.Size;
+    }
+}
+
 OPAQUE_MEMORY* SerializeMemoryList(LIST* List) {
     SANITY_CHECK( AssertSaneMemoryList(List) );
 
     size_t DynamicSize;
     OPAQUE_MEMORY* Total;
-    uint8_t* MemoryIndex;
 
     DynamicSize = SerializedMemoryListSize(List);
     DynamicSize += FIELD_SIZE(OPAQUE_MEMORY, Size) * List->Length;
 
     Total = AllocateOpaqueMemory(DynamicSize);
-    MemoryIndex = (uint8_t*)Total->Data;
+    WriteMemoryList(List, OPAQUE_MEMORY_DATA(Total));
+    return Total;
+}
 
-    OPAQUE_MEMORY Element;
-    ITERATE_MEMORY_TYPE(List, Element) {
-        Memcpy(MemoryIndex, &(Element.Size), sizeof(Element.Size));
-        MemoryIndex += sizeof(Element.Size);
-        Memcpy(MemoryIndex, Element.Data, Element.Size);
-        MemoryIndex += Element.Size;
+OPAQUE_MEMORY* SerializeMemoryListFramed(LIST* List) {
+    SANITY_CHECK( AssertSaneMemoryList(List) );
+
+    size_t DynamicSize = SerializedMemoryListSize(List);
+    DynamicSize += FIELD_SIZE(OPAQUE_MEMORY, Size) * List->Length;
+
+    // The payload is written in place, straight after the header
+    OPAQUE_MEMORY* Frame = AllocateFrame(FrameMemoryList, List->Length, 0, DynamicSize);
+    WriteMemoryList(List, FramePayload(Frame));
+    SealFrame(Frame);
+    return Frame;
+}
+
+static LIST* DeSerializeMemoryListFrame(OPAQUE_MEMORY* Frame, BOOLEAN Copy) {
+    FRAME_HEADER Header;
+    OPAQUE_MEMORY Payload;
+
+    if (OpenFrame(Frame, FrameMemoryList, &Header, &Payload) == FALSE) {
+        return NULL;
     }
-    return Total;
+
+    size_t Offset = (size_t)((uint8_t*)OPAQUE_MEMORY_DATA(&Payload) -
+                             (uint8_t*)OPAQUE_MEMORY_DATA(Frame));
+    LIST* List = DeSerializeMemoryElements(Frame, Offset, Offset + Payload.Size, Copy);
+    if (List != NULL && List->Length != Header.ElementCount) {
+        FreeMemoryList(List);
+        List = NULL;
+    }
+    return List;
+}
+
+LIST* DeSerializeMemoryListFramed(OPAQUE_MEMORY* Frame) {
+    return DeSerializeMemoryListFrame(Frame, TRUE);
+}
+
+LIST* DeSerializeMemoryListViewsFramed(OPAQUE_MEMORY* Frame) {
+    return DeSerializeMemoryListFrame(Frame, FALSE);
+}
+
+OPAQUE_MEMORY* SerializeDataListFramed(LIST* List, size_t ElementSize) {
+    SANITY_CHECK( AssertSaneDataList(List) );
+    SANITY_CHECK( Assert(ElementSize != 0 && ElementSize <= sizeof(OPAQUE_DATA)) );
+
+    OPAQUE_MEMORY* Frame = AllocateFrame(FrameDataList, List->Length,
+                                         (uint32_t)ElementSize, ElementSize * List->Length);
+    WriteDataList(List, ElementSize, FramePayload(Frame));
+    SealFrame(Frame);
+    return Frame;
+}
+
+LIST* DeSerializeDataListFramed(OPAQUE_MEMORY* Frame) {
+    FRAME_HEADER Header;
+    OPAQUE_MEMORY Payload;
+
+    if (OpenFrame(Frame, FrameDataList, &Header, &Payload) == FALSE) {
+        return NULL;
+    }
+    // Checked before dividing, so a zero ElementSize can't get through
+    if (Header.ElementSize == 0 || Header.ElementSize > sizeof(intptr_t) ||
+        Payload.Size / Header.ElementSize != Header.ElementCount) {
+        return NULL;
+    }
+
+    size_t Offset = (size_t)((uint8_t*)OPAQUE_MEMORY_DATA(&Payload) -
+                             (uint8_t*)OPAQUE_MEMORY_DATA(Frame));
+    return DeSerializeDataElements(Frame, Offset, Offset + Payload.Size,
+                                   Header.ElementSize);
 }
 
 OPAQUE_MEMORY* SerializeMemoryListElements(LIST* List) {
@@ -226,11 +380,11 @@ OPAQUE_MEMORY* SerializeMemoryListElements(LIST* List) {
     OPAQUE_MEMORY* Total = AllocateOpaqueMemory(SerializedMemoryListSize(List));
 
     uint8_t* MemoryIndex;
-    MemoryIndex = (uint8_t*)Total->Data;
+    MemoryIndex = (uint8_t*)OPAQUE_MEMORY_DATA(Total);
 
     OPAQUE_MEMORY Element;
     ITERATE_MEMORY_TYPE(List, Element) {
-        Memcpy(MemoryIndex, Element.Data, Element.Size);
+        Memcpy(MemoryIndex, OPAQUE_MEMORY_DATA(&Element), Element.Size);
         MemoryIndex += Element.Size;
     }
     return Total;
@@ -240,6 +394,9 @@ OPAQUE_MEMORY* SerializeMemoryListElements(LIST* List) {
 void ClearDataList(LIST* List) {
     SANITY_CHECK( AssertSaneDataList(List) );
 
+    PROBE(list_clear, List, List->Length);
+    COUNT(ListClears, 1);
+
     PRIMITIVE_DATA_ELEMENT* Current = List->Head;
     while(Current != NULL) {
         PRIMITIVE_DATA_ELEMENT* Next = Current->Next;
@@ -251,6 +408,9 @@ void ClearDataList(LIST* List) {
 void ClearMemoryList(LIST* List) {
     SANITY_CHECK( AssertSaneMemoryList(List) );
 
+    PROBE(list_clear, List, List->Length);
+    COUNT(ListClears, 1);
+
     MEMORY_DATA_ELEMENT* Current = List->Head;
     while(Current != NULL) {
         MEMORY_DATA_ELEMENT* Next = Current->Next;
@@ -260,6 +420,17 @@ void ClearMemoryList(LIST* List) {
     }
 }
 
+void ClearIntrusiveList(LIST* List) {
+    SANITY_CHECK( AssertSaneIntrusiveList(List) );
+
+    PROBE(list_clear, List, List->Length);
+    COUNT(ListClears, 1);
+
+    List->Head   = NULL;
+    List->Tail   = NULL;
+    List->Length = 0;
+}
+
 void FreeDataList(LIST* List) {
     SANITY_CHECK( AssertSaneDataList(List) );
 
@@ -273,3 +444,10 @@ void FreeMemoryList(LIST* List) {
     ClearMemoryList(List);
     Free(List);
 }
+
+void FreeIntrusiveList(LIST* List) {
+    SANITY_CHECK( AssertSaneIntrusiveList(List) );
+
+    ClearIntrusiveList(List);
+    Free(List);
+}
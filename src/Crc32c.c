@@ -0,0 +1,219 @@
+#include <pthread.h>
+
+#include "Crc32c.h"
+#include "Common.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define CRC_X86
+#endif
+
+// Reversed Castagnoli polynomial
+#define CRC32C_POLYNOMIAL 0x82f63b78
+
+/* The hardware kernel runs 3 independent CRCs over consecutive blocks (to
+ *  hide the latency of the crc32 instruction) and then combines them by
+ *  shifting the first ones over the length of the others
+ */
+#define LONG_BLOCK  8192
+#define SHORT_BLOCK 256
+
+typedef uint32_t (*CRC_KERNEL)(uint32_t Crc, const uint8_t* Data, size_t Size);
+
+// Slicing-by-8 tables: SliceTable[K][N] is the CRC of byte N followed by K zeros
+static uint32_t SliceTable[8][256];
+
+// Operators shifting a CRC over LONG_BLOCK and SHORT_BLOCK zero bytes
+static uint32_t LongShift[4][256];
+static uint32_t ShortShift[4][256];
+
+//                          Portable kernel
+
+static uint32_t Crc32cPortable(uint32_t Crc, const uint8_t* Data, size_t Size) {
+    #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (Size >= sizeof(uint64_t)) {
+        uint64_t Word;
+        Memcpy(&Word, Data, sizeof(Word));
+        Word ^= Crc;
+
+        Crc = SliceTable[7][Word & 0xff]         ^ SliceTable[6][(Word >> 8) & 0xff]  ^
+              SliceTable[5][(Word >> 16) & 0xff] ^ SliceTable[4][(Word >> 24) & 0xff] ^
+              SliceTable[3][(Word >> 32) & 0xff] ^ SliceTable[2][(Word >> 40) & 0xff] ^
+              SliceTable[1][(Word >> 48) & 0xff] ^ SliceTable[0][Word >> 56];
+
+        Data += sizeof(Word);
+        Size -= sizeof(Word);
+    }
+    #endif
+    while (Size != 0) {
+        Crc = SliceTable[0][(Crc ^ *Data++) & 0xff] ^ (Crc >> 8);
+        Size--;
+    }
+    return Crc;
+}
+
+//                          SSE4.2 kernel
+
+#ifdef CRC_X86
+static inline uint32_t ShiftCrc(uint32_t Shift[4][256], uint32_t Crc) {
+    return Shift[0][Crc & 0xff] ^ Shift[1][(Crc >> 8) & 0xff] ^
+           Shift[2][(Crc >> 16) & 0xff] ^ Shift[3][Crc >> 24];
+}
+
+#define CRC_WORD(Crc, Address) ({                   \
+    uint64_t Word;                                  \
+    Memcpy(&Word, (Address), sizeof(Word));         \
+    (uint32_t)_mm_crc32_u64((Crc), Word);           \
+})
+
+__attribute__((target("sse4.2")))
+static uint32_t Crc32cSSE42(uint32_t Crc, const uint8_t* Data, size_t Size) {
+    uint64_t Crc0 = Crc;
+
+    // Align to words
+    while (Size != 0 && ((uintptr_t)Data & 7) != 0) {
+        Crc0 = _mm_crc32_u8((uint32_t)Crc0, *Data++);
+        Size--;
+    }
+
+    while (Size >= 3 * LONG_BLOCK) {
+        uint32_t Crc1 = 0, Crc2 = 0;
+        const uint8_t* End = Data + LONG_BLOCK;
+        do {
+            Crc0 = CRC_WORD((uint32_t)Crc0, Data);
+            Crc1 = CRC_WORD(Crc1, Data + LONG_BLOCK);
+            Crc2 = CRC_WORD(Crc2, Data + 2 * LONG_BLOCK);
+            Data += sizeof(uint64_t);
+        } while (Data < End);
+        Crc0 = ShiftCrc(LongShift, (uint32_t)Crc0) ^ Crc1;
+        Crc0 = ShiftCrc(LongShift, (uint32_t)Crc0) ^ Crc2;
+        Data += 2 * LONG_BLOCK;
+        Size -= 3 * LONG_BLOCK;
+    }
+
+    while (Size >= 3 * SHORT_BLOCK) {
+        uint32_t Crc1 = 0, Crc2 = 0;
+        const uint8_t* End = Data + SHORT_BLOCK;
+        do {
+            Crc0 = CRC_WORD((uint32_t)Crc0, Data);
+            Crc1 = CRC_WORD(Crc1, Data + SHORT_BLOCK);
+            Crc2 = CRC_WORD(Crc2, Data + 2 * SHORT_BLOCK);
+            Data += sizeof(uint64_t);
+        } while (Data < End);
+        Crc0 = ShiftCrc(ShortShift, (uint32_t)Crc0) ^ Crc1;
+        Crc0 = ShiftCrc(ShortShift, (uint32_t)Crc0) ^ Crc2;
+        Data += 2 * SHORT_BLOCK;
+        Size -= 3 * SHORT_BLOCK;
+    }
+
+    while (Size >= sizeof(uint64_t)) {
+        Crc0 = CRC_WORD((uint32_t)Crc0, Data);
+        Data += sizeof(uint64_t);
+        Size -= sizeof(uint64_t);
+    }
+    while (Size != 0) {
+        Crc0 = _mm_crc32_u8((uint32_t)Crc0, *Data++);
+        Size--;
+    }
+    return (uint32_t)Crc0;
+}
+#endif
+
+static CRC_KERNEL CrcKernel = Crc32cPortable;
+// Tables are built on the first call, which may come from another constructor
+static pthread_once_t CrcOnce = PTHREAD_ONCE_INIT;
+
+//                          Table generation
+
+/* Multiply the 32x32 GF(2) `Matrix` by `Vector` */
+static uint32_t Gf2MatrixTimes(const uint32_t* Matrix, uint32_t Vector) {
+    uint32_t Sum = 0;
+
+    while (Vector != 0) {
+        if (Vector & 1) {
+            Sum ^= *Matrix;
+        }
+        Vector >>= 1;
+        Matrix++;
+    }
+    return Sum;
+}
+
+static void Gf2MatrixSquare(uint32_t* Square, const uint32_t* Matrix) {
+    for (int Row = 0; Row != 32; Row++) {
+        Square[Row] = Gf2MatrixTimes(Matrix, Matrix[Row]);
+    }
+}
+
+/* Operator that applies `Length` (a power of 2) zero bytes to a CRC */
+static void ZerosOperator(uint32_t* Even, size_t Length) {
+    uint32_t Odd[32];
+    uint32_t Row = 1;
+
+    // Operator for a single zero bit
+    Odd[0] = CRC32C_POLYNOMIAL;
+    for (int Bit = 1; Bit != 32; Bit++) {
+        Odd[Bit] = Row;
+        Row <<= 1;
+    }
+
+    // 2 and then 4 zero bits
+    Gf2MatrixSquare(Even, Odd);
+    Gf2MatrixSquare(Odd, Even);
+
+    // Each squaring doubles the amount of zeros, starting at 1 byte
+    do {
+        Gf2MatrixSquare(Even, Odd);
+        Length >>= 1;
+        if (Length == 0) {
+            return;
+        }
+        Gf2MatrixSquare(Odd, Even);
+        Length >>= 1;
+    } while (Length != 0);
+
+    Memcpy(Even, Odd, sizeof(Odd));
+}
+
+static void SetupShiftTable(uint32_t Shift[4][256], size_t Length) {
+    uint32_t Operator[32];
+
+    ZerosOperator(Operator, Length);
+    for (uint32_t Byte = 0; Byte != 256; Byte++) {
+        Shift[0][Byte] = Gf2MatrixTimes(Operator, Byte);
+        Shift[1][Byte] = Gf2MatrixTimes(Operator, Byte << 8);
+        Shift[2][Byte] = Gf2MatrixTimes(Operator, Byte << 16);
+        Shift[3][Byte] = Gf2MatrixTimes(Operator, Byte << 24);
+    }
+}
+
+static void SetupCrc32c(void) {
+    for (uint32_t Byte = 0; Byte != 256; Byte++) {
+        uint32_t Crc = Byte;
+        for (int Bit = 0; Bit != 8; Bit++) {
+            Crc = (Crc & 1) ? (Crc >> 1) ^ CRC32C_POLYNOMIAL : Crc >> 1;
+        }
+        SliceTable[0][Byte] = Crc;
+    }
+    for (uint32_t Byte = 0; Byte != 256; Byte++) {
+        for (int Slice = 1; Slice != 8; Slice++) {
+            uint32_t Previous = SliceTable[Slice - 1][Byte];
+            SliceTable[Slice][Byte] = (Previous >> 8) ^ SliceTable[0][Previous & 0xff];
+        }
+    }
+
+    #ifdef CRC_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse4.2")) {
+        SetupShiftTable(LongShift, LONG_BLOCK);
+        SetupShiftTable(ShortShift, SHORT_BLOCK);
+        CrcKernel = Crc32cSSE42;
+    }
+    #endif
+}
+
+uint32_t Crc32c(uint32_t Crc, const void* Data, size_t Size) {
+    pthread_once(&CrcOnce, SetupCrc32c);
+    return ~CrcKernel(~Crc, Data, Size);
+}
@@ -0,0 +1,116 @@
+#include "Frame.h"
+#include "Crc32c.h"
+
+_Static_assert(sizeof(FRAME_HEADER) == 40, "FRAME_HEADER must not have padding");
+
+static size_t BlockCount(uint64_t PayloadSize, uint32_t BlockSize) {
+    return (size_t)(PayloadSize / BlockSize + (PayloadSize % BlockSize != 0));
+}
+
+/* CRC of the header (with HeaderCrc as 0) followed by the block CRC table */
+static uint32_t HeaderCrc(FRAME_HEADER Header, const uint8_t* CrcTable,
+                          size_t CrcTableSize) {
+    Header.HeaderCrc = 0;
+    uint32_t Crc = Crc32c(0, &Header, sizeof(Header));
+    return Crc32c(Crc, CrcTable, CrcTableSize);
+}
+
+OPAQUE_MEMORY* AllocateFrame(FRAME_KIND Kind, uint64_t ElementCount,
+                             uint32_t ElementSize, size_t PayloadSize) {
+    size_t CrcTableSize = BlockCount(PayloadSize, FRAME_BLOCK_SIZE) * sizeof(uint32_t);
+    OPAQUE_MEMORY* Frame = AllocateOpaqueMemory(sizeof(FRAME_HEADER) + CrcTableSize +
+                                                PayloadSize);
+    FRAME_HEADER Header = {
+        .Magic        = FRAME_MAGIC,
+        .Version      = FRAME_VERSION,
+        .Kind         = (uint16_t)Kind,
+        .ElementSize  = ElementSize,
+        .BlockSize    = FRAME_BLOCK_SIZE,
+        .ElementCount = ElementCount,
+        .PayloadSize  = PayloadSize,
+        .HeaderCrc    = 0,
+        .Reserved     = 0,
+    };
+    Memcpy(OPAQUE_MEMORY_DATA(Frame), &Header, sizeof(Header));
+    return Frame;
+}
+
+uint8_t* FramePayload(OPAQUE_MEMORY* Frame) {
+    FRAME_HEADER Header;
+
+    Memcpy(&Header, OPAQUE_MEMORY_DATA(Frame), sizeof(Header));
+    return (uint8_t*)OPAQUE_MEMORY_DATA(Frame) + sizeof(Header) +
+           BlockCount(Header.PayloadSize, Header.BlockSize) * sizeof(uint32_t);
+}
+
+void SealFrame(OPAQUE_MEMORY* Frame) {
+    FRAME_HEADER Header;
+    uint8_t* Data = OPAQUE_MEMORY_DATA(Frame);
+
+    Memcpy(&Header, Data, sizeof(Header));
+    size_t Blocks = BlockCount(Header.PayloadSize, Header.BlockSize);
+    uint8_t* CrcTable = Data + sizeof(Header);
+    uint8_t* Payload = CrcTable + Blocks * sizeof(uint32_t);
+
+    SANITY_CHECK( Assert(Frame->Size == sizeof(Header) + Blocks * sizeof(uint32_t) +
+                                        Header.PayloadSize) );
+
+    for (size_t BlockInd = 0; BlockInd != Blocks; BlockInd++) {
+        size_t Offset = BlockInd * Header.BlockSize;
+        size_t Size = (size_t)(Header.PayloadSize - Offset < Header.BlockSize ?
+                             Header.PayloadSize - Offset : Header.BlockSize);
+        uint32_t Crc = Crc32c(0, Payload + Offset, Size);
+        Memcpy(CrcTable + BlockInd * sizeof(Crc), &Crc, sizeof(Crc));
+    }
+
+    Header.HeaderCrc = HeaderCrc(Header, CrcTable, Blocks * sizeof(uint32_t));
+    Memcpy(Data, &Header, sizeof(Header));
+}
+
+BOOLEAN OpenFrame(OPAQUE_MEMORY* Frame, FRAME_KIND Kind, FRAME_HEADER* Header,
+                  OPAQUE_MEMORY* Payload) {
+    SANITY_CHECK( AssertSaneOpaqueMemory(Frame) );
+
+    uint8_t* Data = OPAQUE_MEMORY_DATA(Frame);
+    if (Frame->Size < sizeof(*Header)) {
+        return FALSE;
+    }
+    Memcpy(Header, Data, sizeof(*Header));
+
+    if (Header->Magic != FRAME_MAGIC || Header->Version != FRAME_VERSION ||
+        Header->Kind != Kind || Header->BlockSize == 0) {
+        return FALSE;
+    }
+
+    // Every size is checked against what is left, so nothing can overflow
+    size_t Remaining = Frame->Size - sizeof(*Header);
+    if (Header->PayloadSize > Remaining) {
+        return FALSE;
+    }
+    size_t Blocks = BlockCount(Header->PayloadSize, Header->BlockSize);
+    if (Blocks != (Remaining - Header->PayloadSize) / sizeof(uint32_t) ||
+        (Remaining - Header->PayloadSize) % sizeof(uint32_t) != 0) {
+        return FALSE;
+    }
+
+    uint8_t* CrcTable = Data + sizeof(*Header);
+    uint8_t* PayloadData = CrcTable + Blocks * sizeof(uint32_t);
+    if (HeaderCrc(*Header, CrcTable, Blocks * sizeof(uint32_t)) != Header->HeaderCrc) {
+        return FALSE;
+    }
+
+    for (size_t BlockInd = 0; BlockInd != Blocks; BlockInd++) {
+        size_t Offset = BlockInd * Header->BlockSize;
+        size_t Size = (size_t)(Header->PayloadSize - Offset < Header->BlockSize ?
+                             Header->PayloadSize - Offset : Header->BlockSize);
+        uint32_t Crc;
+        Memcpy(&Crc, CrcTable + BlockInd * sizeof(Crc), sizeof(Crc));
+        if (Crc32c(0, PayloadData + Offset, Size) != Crc) {
+            return FALSE;
+        }
+    }
+
+    *Payload = SliceOpaqueMemory(Frame, (size_t)(PayloadData - Data),
+                                 (size_t)Header->PayloadSize);
+    return TRUE;
+}
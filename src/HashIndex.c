@@ -0,0 +1,106 @@
+#include "HashIndex.h"
+
+#define MINIMUM_CAPACITY 16
+
+static size_t HashIndexSlot(const HASH_INDEX* Index, uint64_t Key);
+
+static void GrowHashIndex(HASH_INDEX* Index);
+
+uint64_t HashName(const char* Name) {
+    uint64_t Hash = UINT64_C(0xcbf29ce484222325);
+    size_t Length = Strlen(Name);
+
+    // Same as HASH_NAME: names are padded with zeros up to the maximum length
+    for (size_t CharacterInd = 0;
+         CharacterInd < Length || CharacterInd < HASH_NAME_MAX_LENGTH;
+         CharacterInd++) {
+        uint64_t Character = CharacterInd < Length ? (uint8_t)Name[CharacterInd] : 0;
+        Hash = Hash * HASH_NAME_PRIME + Character;
+    }
+    return Hash ^ (uint64_t)Length;
+}
+
+HASH_INDEX* AllocateHashIndex(size_t ExpectedLength) {
+    ALLOC_STRUCT(HASH_INDEX, Index);
+    size_t Capacity = MINIMUM_CAPACITY;
+
+    while (Capacity / 4 * 3 < ExpectedLength) {
+        Capacity *= 2;
+    }
+
+    Index->Capacity = Capacity;
+    Index->Length   = 0;
+    Index->Entries  = Malloc(Capacity * sizeof(HASH_INDEX_ENTRY));
+    memset(Index->Entries, 0, Capacity * sizeof(HASH_INDEX_ENTRY));
+
+    return Index;
+}
+
+BOOLEAN HashIndexInsert(HASH_INDEX* Index, uint64_t Key, void* Value) {
+    SANITY_CHECK( Assert(Index != NULL && Value != NULL) );
+
+    if (Index->Length + 1 > Index->Capacity / 4 * 3) {
+        GrowHashIndex(Index);
+    }
+
+    size_t Mask = Index->Capacity - 1;
+    for (size_t Slot = HashIndexSlot(Index, Key); ; Slot = (Slot + 1) & Mask) {
+        HASH_INDEX_ENTRY* Entry = &(Index->Entries[Slot]);
+        if (Entry->Value == NULL) {
+            Entry->Key   = Key;
+            Entry->Value = Value;
+            Index->Length++;
+            return TRUE;
+        }
+        if (Entry->Key == Key) {
+            return FALSE;
+        }
+    }
+}
+
+void* HashIndexFind(const HASH_INDEX* Index, uint64_t Key) {
+    SANITY_CHECK( Assert(Index != NULL) );
+
+    size_t Mask = Index->Capacity - 1;
+    for (size_t Slot = HashIndexSlot(Index, Key); ; Slot = (Slot + 1) & Mask) {
+        HASH_INDEX_ENTRY* Entry = &(Index->Entries[Slot]);
+        if (Entry->Value == NULL) {
+            return NULL;
+        }
+        if (Entry->Key == Key) {
+            return Entry->Value;
+        }
+    }
+}
+
+void FreeHashIndex(HASH_INDEX* Index) {
+    if (Index == NULL) {
+        return;
+    }
+    Free(Index->Entries);
+    Free(Index);
+}
+
+/* Fibonacci hashing spreads keys that only differ in their low or high bits
+ *  (pointers, sequential IDs) across the whole table
+ */
+static size_t HashIndexSlot(const HASH_INDEX* Index, uint64_t Key) {
+    return (size_t)((Key * UINT64_C(0x9e3779b97f4a7c15)) >> 32) & (Index->Capacity - 1);
+}
+
+static void GrowHashIndex(HASH_INDEX* Index) {
+    HASH_INDEX_ENTRY* OldEntries = Index->Entries;
+    size_t OldCapacity = Index->Capacity;
+
+    Index->Capacity = OldCapacity * 2;
+    Index->Length   = 0;
+    Index->Entries  = Malloc(Index->Capacity * sizeof(HASH_INDEX_ENTRY));
+    memset(Index->Entries, 0, Index->Capacity * sizeof(HASH_INDEX_ENTRY));
+
+    for (size_t Slot = 0; Slot != OldCapacity; Slot++) {
+        if (OldEntries[Slot].Value != NULL) {
+            HashIndexInsert(Index, OldEntries[Slot].Key, OldEntries[Slot].Value);
+        }
+    }
+    Free(OldEntries);
+}
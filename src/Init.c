@@ -1,124 +1,923 @@
+#define _GNU_SOURCE
+#include <inttypes.h>
+#include <link.h>
+#include <time.h>
+#include <unistd.h>
+
 #include "Init.h"
+#include "InitSimulation.h"
+#include "Probes.h"
+#include "Log.h"
 
 LIST* InitInfoList = NULL;
+// Registered handlers by address and name ID
+static HASH_INDEX* InitInfoIndex = NULL;
+
+TYPE_STRUCT(INIT_SNAPSHOT_HOOKS) {
+    NO_DATA_ELEMENT          Link;
+    CONSTRUCTOR_HANDLER      Handler;
+    SNAPSHOT_SAVE_HANDLER    Save;
+    SNAPSHOT_RESTORE_HANDLER Restore;
+};
+
+static LIST*            SnapshotHookList    = NULL;
+static char*            SnapshotPath        = NULL;
+static char*            ProfilePath         = NULL;
+// Loaded snapshot: [ Build ID | Location 1 | State 1 | Location 2 .. ]
+static LIST*            SnapshotList        = NULL;
+
+// All handlers in dependency order, until initialization finishes
+static OPAQUE_MEMORY    RunOrder;
+// Handlers with any of these INIT_FLAGS are left for a later pass
+static uint32_t         DeferredFlags       = 0;
+// If TRUE, only handlers marked as Targeted run in this pass
+static BOOLEAN          TargetedPass        = FALSE;
+
+/* State shared with the background workers. Only valid while
+ *  BackgroundRunning is TRUE
+ */
+static pthread_mutex_t  BackgroundLock      = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   BackgroundProgress  = PTHREAD_COND_INITIALIZER;
+static BOOLEAN          BackgroundRunning   = FALSE;
+static uint64_t         BackgroundNext      = 0;
+static pthread_t        BackgroundWorkers[INIT_BACKGROUND_WORKERS];
+static int              StartedWorkers      = 0;
 
-static BOOLEAN HandlerDependsOn(INIT_INFORMATION* InitInfo,
-                                CONSTRUCTOR_HANDLER Dependency);
+static INIT_INFORMATION* AddInitInformation(const char Location[],
+                                            CONSTRUCTOR_HANDLER Handler,
+                                            size_t DependencyAmmount,
+                                            uint32_t Flags);
 
 static OPAQUE_MEMORY OrganizeInitInformation(void);
 
+static void OrderHandler(INIT_INFORMATION* InitInfo, INIT_INFORMATION** InfoArray,
+                         uint64_t* InsertedAmmount);
+
+static void WaitForHandlerID(uint64_t ID);
+
+static void PrepareRunOrder(void);
+
+static void MarkTargeted(INIT_INFORMATION* InitInfo);
+
+static BOOLEAN RunPendingHandlers(void);
+
+static BOOLEAN RunsInThisPass(INIT_INFORMATION* InitInfo);
+
+static void RunHandlerWhenReady(INIT_INFORMATION* InitInfo);
+
+static void JoinBackgroundWorkers(void);
+
+static void SaveOutdatedSnapshot(void);
+
+static void* BackgroundWorker(void* Unused);
+
 static void ReleaseInitInfo(void);
 
+static void FinishInitialization(void);
+
+static void AttachSnapshotHooks(void);
+
+static OPAQUE_MEMORY GetBuildID(void);
+
+static LIST* LoadSnapshot(void);
+
+static void SaveSnapshot(void);
+
+static uint64_t GetTime(void);
+
+static void SaveProfile(void);
+
+static BOOLEAN LoadProfile(const char* Path);
+
 
 void RegisterConstructor(const char Location[], CONSTRUCTOR_HANDLER Handler, OPAQUE_MEMORY Dependencies){
+    RegisterFlaggedConstructor(Location, Handler, Dependencies, InitForeground);
+}
+
+void RegisterFlaggedConstructor(const char Location[],
+                                CONSTRUCTOR_HANDLER Handler,
+                                OPAQUE_MEMORY Dependencies, uint32_t Flags) {
+    CONSTRUCTOR_HANDLER* HandlerArray = OPAQUE_MEMORY_DATA(&Dependencies);
+    uint64_t DependencyAmmount = Dependencies.Size / sizeof(CONSTRUCTOR_HANDLER);
+
+    INIT_INFORMATION* NewEntry = AddInitInformation(Location, Handler,
+                                                    DependencyAmmount, Flags);
+
+    uint64_t* IDArray = OPAQUE_MEMORY_DATA(NewEntry->Dependencies);
+    for(uint64_t DependencyInd = 0; DependencyInd != DependencyAmmount; DependencyInd++) {
+        IDArray[DependencyInd] = HANDLER_ID(HandlerArray[DependencyInd]);
+    }
+}
+
+void RegisterNamedConstructor(const char Location[], uint64_t NameID,
+                              CONSTRUCTOR_HANDLER Handler,
+                              OPAQUE_MEMORY Dependencies, uint32_t Flags) {
+    INIT_INFORMATION* NewEntry = AddInitInformation(Location, Handler,
+                                                    Dependencies.Size / sizeof(uint64_t),
+                                                    Flags);
+    CopyOpaqueMemory(NewEntry->Dependencies, &Dependencies);
+
+    if (HashIndexInsert(InitInfoIndex, NameID, NewEntry) == FALSE) {
+        LOG_ERROR("Handler name already registered: %s", Location);
+        abort();
+    }
+}
+
+void RunInitializationFunctions(void) {
+    if (InitInfoList == NULL) {
+        return;
+    }
+
+    PrepareRunOrder();
+
+    if (RunPendingHandlers() == TRUE) {
+        // Order and information are released once the workers are joined
+        return;
+    }
+
+    FinishInitialization();
+}
+
+void RunInitializationFunctionsForIDs(const uint64_t* Targets, size_t TargetAmmount) {
+    INIT_INFORMATION* InitInfo;
+
+    if (InitInfoList == NULL) {
+        return;
+    }
+
+    PrepareRunOrder();
+
+    for (size_t TargetInd = 0; TargetInd != TargetAmmount; TargetInd++) {
+        INIT_INFORMATION* Target = HashIndexFind(InitInfoIndex, Targets[TargetInd]);
+        if (Target == NULL) {
+            LOG_ERROR("Unregistered initialization target");
+            abort();
+        }
+        MarkTargeted(Target);
+    }
+
+    // Workers only pick targeted handlers while the pass is restricted
+    TargetedPass = TRUE;
+    if (RunPendingHandlers() == TRUE) {
+        JoinBackgroundWorkers();
+    }
+    TargetedPass = FALSE;
+
+    BOOLEAN AllCompleted = TRUE;
+    ITERATE_INTRUSIVE_TYPE(InitInfoList, INIT_INFORMATION, Link, InitInfo) {
+        InitInfo->Targeted = FALSE;
+        if (InitInfo->Completed == FALSE) {
+            AllCompleted = FALSE;
+        }
+    }
+
+    // The remaining handlers are kept for a later call
+    if (AllCompleted == TRUE) {
+        FinishInitialization();
+    }
+}
+
+void RunForkSafeInitializationFunctions(void) {
+    INIT_INFORMATION** InfoArray;
+    uint64_t HandlerAmmount;
+
+    if (InitInfoList == NULL) {
+        return;
+    }
+
+    PrepareRunOrder();
+    InfoArray = OPAQUE_MEMORY_DATA(&RunOrder);
+    HandlerAmmount = RunOrder.Size / sizeof(INIT_INFORMATION*);
+
+    // Fork safe handlers can't wait on handlers that only run after the fork
+    for(uint64_t InfoInd = 0; InfoInd != HandlerAmmount; InfoInd++) {
+        INIT_INFORMATION* InitInfo = InfoArray[InfoInd];
+        uint64_t* DependencyArray = OPAQUE_MEMORY_DATA(InitInfo->Dependencies);
+        uint64_t DependencyAmmount = InitInfo->Dependencies->Size / sizeof(uint64_t);
+
+        if (InitInfo->Flags & InitPostFork) {
+            continue;
+        }
+        for(uint64_t DependencyInd = 0; DependencyInd != DependencyAmmount; DependencyInd++) {
+            INIT_INFORMATION* Dependency = HashIndexFind(InitInfoIndex, DependencyArray[DependencyInd]);
+            if (Dependency->Flags & InitPostFork) {
+                LOG_ERROR("Fork safe handler depends on a post fork one: %s", InitInfo->Location);
+                abort();
+            }
+        }
+    }
+
+    // Threads don't survive a fork, so background handlers must finish here
+    DeferredFlags = InitPostFork;
+    if (RunPendingHandlers() == TRUE) {
+        JoinBackgroundWorkers();
+    }
+    DeferredFlags = 0;
+
+    SaveOutdatedSnapshot();
+}
+
+void RunPostForkInitializationFunctions(void) {
+    if (InitInfoList == NULL) {
+        return;
+    }
+
+    // Only the zygote keeps the snapshot up to date
+    SetInitializationSnapshot(NULL);
+
+    // Without a fork safe pass before, everything runs here
+    if (RunOrder.Size == 0) {
+        PrepareRunOrder();
+    }
+
+    if (RunPendingHandlers() == TRUE) {
+        return;
+    }
+
+    FinishInitialization();
+}
+
+void ReleaseInitializationFunctions(void) {
+    FinishInitialization();
+}
+
+void RegisterConstructorSnapshot(CONSTRUCTOR_HANDLER Handler,
+                                 SNAPSHOT_SAVE_HANDLER Save,
+                                 SNAPSHOT_RESTORE_HANDLER Restore) {
+    ALLOC_STRUCT(INIT_SNAPSHOT_HOOKS, NewHooks);
+
+    if (SnapshotHookList == NULL) {
+        SnapshotHookList = AllocateList();
+    }
+
+    NewHooks->Handler = Handler;
+    NewHooks->Save    = Save;
+    NewHooks->Restore = Restore;
+
+    IntrusiveListInsert(SnapshotHookList, &(NewHooks->Link));
+}
+
+void SetInitializationSnapshot(const char* Path) {
+    Free(SnapshotPath);
+    SnapshotPath = NULL;
+
+    if (Path != NULL) {
+        SnapshotPath = DuplicateGenericMemory(Path, Strlen(Path) + 1);
+    }
+}
+
+void SetInitializationProfile(const char* Path) {
+    Free(ProfilePath);
+    ProfilePath = NULL;
+
+    if (Path != NULL) {
+        ProfilePath = DuplicateGenericMemory(Path, Strlen(Path) + 1);
+    }
+}
+
+void SimulateInitialization(const char* DurationsPath, uint32_t Cores) {
+    if (InitInfoList == NULL) {
+        return;
+    }
+
+    PrepareRunOrder();
+
+    INIT_INFORMATION** InfoArray = OPAQUE_MEMORY_DATA(&RunOrder);
+    uint64_t HandlerAmmount = RunOrder.Size / sizeof(INIT_INFORMATION*);
+
+    if (DurationsPath == NULL) {
+        if (RunPendingHandlers() == TRUE) {
+            JoinBackgroundWorkers();
+        }
+    } else if (LoadProfile(DurationsPath) == FALSE) {
+        LOG_WARNING("Could not read handler durations from %s", DurationsPath);
+    }
+
+    if (Cores == 0) {
+        long OnlineCores = sysconf(_SC_NPROCESSORS_ONLN);
+        Cores = (OnlineCores > 0) ? (uint32_t)OnlineCores : 1;
+    }
+
+    // Handlers are simulated by their' position in the run order
+    HASH_INDEX* Positions = AllocateHashIndex(HandlerAmmount);
+    SIMULATED_HANDLER* Simulated = Malloc(HandlerAmmount * sizeof(SIMULATED_HANDLER));
+
+    for(uint64_t InfoInd = 0; InfoInd != HandlerAmmount; InfoInd++) {
+        INIT_INFORMATION* InitInfo = InfoArray[InfoInd];
+        uint64_t* DependencyArray = OPAQUE_MEMORY_DATA(InitInfo->Dependencies);
+        uint64_t DependencyAmmount = InitInfo->Dependencies->Size / sizeof(uint64_t);
+
+        HashIndexInsert(Positions, (uintptr_t)InitInfo, (void*)(uintptr_t)(InfoInd + 1));
+
+        Simulated[InfoInd].Location = InitInfo->Location;
+        Simulated[InfoInd].Duration = InitInfo->Duration;
+        SetupOpaqueMemory(&Simulated[InfoInd].Dependencies, DependencyAmmount * sizeof(size_t));
+
+        size_t* Dependencies = OPAQUE_MEMORY_DATA(&Simulated[InfoInd].Dependencies);
+        for(uint64_t DependencyInd = 0; DependencyInd != DependencyAmmount; DependencyInd++) {
+            INIT_INFORMATION* Dependency = HashIndexFind(InitInfoIndex, DependencyArray[DependencyInd]);
+            // Positions are stored + 1, as the index can't hold NULL values
+            void* Position = HashIndexFind(Positions, (uintptr_t)Dependency);
+            Dependencies[DependencyInd] = (uintptr_t)Position - 1;
+        }
+    }
+
+    ReportSimulation(Simulated, HandlerAmmount, Cores);
+
+    for(uint64_t InfoInd = 0; InfoInd != HandlerAmmount; InfoInd++) {
+        ClearOpaqueMemory(&Simulated[InfoInd].Dependencies);
+    }
+    Free(Simulated);
+    FreeHashIndex(Positions);
+
+    FinishInitialization();
+}
+
+void WaitForInitialization(CONSTRUCTOR_HANDLER Handler) {
+    WaitForHandlerID(HANDLER_ID(Handler));
+}
+
+void WaitForNamedInitialization(const char* Name) {
+    WaitForHandlerID(HashName(Name));
+}
+
+void WaitForBackgroundInitialization(void) {
+    if (BackgroundRunning == FALSE) {
+        return;
+    }
+
+    JoinBackgroundWorkers();
+    FinishInitialization();
+}
+
+/* (Re)compute the run order, including handlers registered since the last
+ *  call
+ */
+static void PrepareRunOrder(void) {
+    // A previous pass may have left background handlers running
+    if (BackgroundRunning == TRUE) {
+        JoinBackgroundWorkers();
+    }
+
+    AttachSnapshotHooks();
+
+    ClearOpaqueMemory(&RunOrder);
+    RunOrder = OrganizeInitInformation();
+}
+
+/* Mark `InitInfo` and everything it (transitively) depends on */
+static void MarkTargeted(INIT_INFORMATION* InitInfo) {
+    uint64_t* DependencyArray = OPAQUE_MEMORY_DATA(InitInfo->Dependencies);
+    uint64_t DependencyAmmount = InitInfo->Dependencies->Size / sizeof(uint64_t);
+
+    if (InitInfo->Targeted == TRUE) {
+        return;
+    }
+    InitInfo->Targeted = TRUE;
+
+    for(uint64_t DependencyInd = 0; DependencyInd != DependencyAmmount; DependencyInd++) {
+        MarkTargeted(HashIndexFind(InitInfoIndex, DependencyArray[DependencyInd]));
+    }
+}
+
+/* Run, in order, every handler that didn't run yet and isn't deferred.
+ * Returns TRUE if background handlers were started, in which case they may
+ *  still be running
+ */
+static BOOLEAN RunPendingHandlers(void) {
+    INIT_INFORMATION** InfoArray = OPAQUE_MEMORY_DATA(&RunOrder);
+    uint64_t HandlerAmmount = RunOrder.Size / sizeof(INIT_INFORMATION*);
+    BOOLEAN HasBackground = FALSE;
+
+    for(uint64_t InfoInd = 0; InfoInd != HandlerAmmount; InfoInd++) {
+        if (RunsInThisPass(InfoArray[InfoInd]) == TRUE &&
+            (InfoArray[InfoInd]->Flags & InitBackground)) {
+            HasBackground = TRUE;
+        }
+    }
+
+    // Start background workers. They pick background handlers in order
+    if (HasBackground == TRUE) {
+        SANITY_CHECK( Assert(BackgroundRunning == FALSE) );
+
+        BackgroundNext    = 0;
+        StartedWorkers    = 0;
+        pthread_mutex_lock(&BackgroundLock);
+        BackgroundRunning = TRUE;
+        pthread_mutex_unlock(&BackgroundLock);
+        while (StartedWorkers != INIT_BACKGROUND_WORKERS &&
+               pthread_create(&BackgroundWorkers[StartedWorkers], NULL,
+                              BackgroundWorker, NULL) == 0) {
+            StartedWorkers++;
+        }
+
+        // Without any worker, background handlers run in the foreground
+        if (StartedWorkers == 0) {
+            LOG_WARNING("Could not start background workers, running background handlers in the foreground");
+            pthread_mutex_lock(&BackgroundLock);
+            BackgroundRunning = FALSE;
+            pthread_mutex_unlock(&BackgroundLock);
+            HasBackground     = FALSE;
+        }
+    }
+
+    // Run all foreground handlers. Background ones are skipped before looking
+    //  at Completed, which the workers write under BackgroundLock
+    for(uint64_t InfoInd = 0; InfoInd != HandlerAmmount; InfoInd++) {
+        if ((HasBackground == FALSE || (InfoArray[InfoInd]->Flags & InitBackground) == 0) &&
+            RunsInThisPass(InfoArray[InfoInd]) == TRUE) {
+            RunHandlerWhenReady(InfoArray[InfoInd]);
+        }
+    }
+
+    return HasBackground;
+}
+
+static BOOLEAN RunsInThisPass(INIT_INFORMATION* InitInfo) {
+    return InitInfo->Completed == FALSE && (InitInfo->Flags & DeferredFlags) == 0 &&
+           (TargetedPass == FALSE || InitInfo->Targeted == TRUE);
+}
+
+static void JoinBackgroundWorkers(void) {
+    for (int Worker = 0; Worker != StartedWorkers; Worker++) {
+        pthread_join(BackgroundWorkers[Worker], NULL);
+    }
+    StartedWorkers = 0;
+
+    pthread_mutex_lock(&BackgroundLock);
+    BackgroundRunning = FALSE;
+    pthread_mutex_unlock(&BackgroundLock);
+}
+
+/* Wait for the dependencies of `InitInfo` to complete, then run it.
+ * Handlers are always picked in dependency order so whatever is being waited
+ *  on has already been picked by some thread
+ */
+static void RunHandlerWhenReady(INIT_INFORMATION* InitInfo) {
+    uint64_t* DependencyArray = OPAQUE_MEMORY_DATA(InitInfo->Dependencies);
+    uint64_t DependencyAmmount = InitInfo->Dependencies->Size / sizeof(uint64_t);
+
+    pthread_mutex_lock(&BackgroundLock);
+    BOOLEAN Background = BackgroundRunning;
+    pthread_mutex_unlock(&BackgroundLock);
+
+    if (Background == TRUE) {
+        for(uint64_t DependencyInd = 0; DependencyInd != DependencyAmmount; DependencyInd++) {
+            WaitForHandlerID(DependencyArray[DependencyInd]);
+        }
+    }
+
+    PROBE(handler_start, InitInfo->Location, InitInfo->Handler);
+    uint64_t Start = GetTime();
+
+    if (InitInfo->SnapshotState.Data != NULL &&
+        InitInfo->RestoreState(&(InitInfo->SnapshotState)) == TRUE) {
+        InitInfo->Restored = TRUE;
+    } else {
+        InitInfo->Handler();
+    }
+
+    InitInfo->Duration = GetTime() - Start;
+    PROBE(handler_end, InitInfo->Location, InitInfo->Handler, InitInfo->Restored);
+    COUNT(HandlersRun, 1);
+
+    // Workers may have been joined by the handler itself, so lock regardless
+    pthread_mutex_lock(&BackgroundLock);
+    InitInfo->Completed = TRUE;
+    pthread_cond_broadcast(&BackgroundProgress);
+    pthread_mutex_unlock(&BackgroundLock);
+}
+
+static void* BackgroundWorker(void* Unused) {
+    (void)Unused;
+    INIT_INFORMATION** InfoArray = OPAQUE_MEMORY_DATA(&RunOrder);
+    uint64_t HandlerAmmount = RunOrder.Size / sizeof(INIT_INFORMATION*);
+
+    while (TRUE) {
+        INIT_INFORMATION* Picked = NULL;
+
+        pthread_mutex_lock(&BackgroundLock);
+        while (BackgroundNext != HandlerAmmount) {
+            INIT_INFORMATION* Candidate = InfoArray[BackgroundNext++];
+            if ((Candidate->Flags & InitBackground) && RunsInThisPass(Candidate) == TRUE) {
+                Picked = Candidate;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&BackgroundLock);
+
+        if (Picked == NULL) {
+            return NULL;
+        }
+        RunHandlerWhenReady(Picked);
+    }
+}
+
+/* Block until the handler with `ID` ran, if background initialization is in
+ *  progress
+ */
+static void WaitForHandlerID(uint64_t ID) {
+    pthread_mutex_lock(&BackgroundLock);
+    if (BackgroundRunning == TRUE) {
+        INIT_INFORMATION* InitInfo = HashIndexFind(InitInfoIndex, ID);
+
+        while (InitInfo != NULL && InitInfo->Completed == FALSE) {
+            pthread_cond_wait(&BackgroundProgress, &BackgroundLock);
+        }
+    }
+    pthread_mutex_unlock(&BackgroundLock);
+}
+
+static INIT_INFORMATION* AddInitInformation(const char Location[],
+                                            CONSTRUCTOR_HANDLER Handler,
+                                            size_t DependencyAmmount,
+                                            uint32_t Flags) {
     ALLOC_STRUCT(INIT_INFORMATION, NewEntry);
 
+    PROBE(register_constructor, Location, Handler, Flags);
+    COUNT(ConstructorsRegistered, 1);
+
     if (InitInfoList == NULL) {
         InitInfoList = AllocateList();
+        InitInfoIndex = AllocateHashIndex(0);
     }
 
     // Info allocation
     NewEntry->Handler  = Handler;
     NewEntry->Location = Malloc(strlen(Location) + 1);
     Memcpy(NewEntry->Location, Location, strlen(Location) + 1);
-    NewEntry->Dependencies = AllocateOpaqueMemory(Dependencies.Size);
-    NewEntry->PendingDependencies = Dependencies.Size / sizeof(CONSTRUCTOR_HANDLER);
-    CopyOpaqueMemory(NewEntry->Dependencies, &Dependencies);
+    NewEntry->Dependencies = AllocateOpaqueMemory(DependencyAmmount * sizeof(uint64_t));
+    NewEntry->Flags     = Flags;
+    NewEntry->Visiting  = FALSE;
+    NewEntry->Ordered   = FALSE;
+    NewEntry->Completed = FALSE;
+    NewEntry->Targeted  = FALSE;
+    NewEntry->SaveState     = NULL;
+    NewEntry->RestoreState  = NULL;
+    NewEntry->SnapshotState = CLOAK_MEMORY(0, FALSE, NULL);
+    NewEntry->Restored      = FALSE;
+    NewEntry->Duration      = 0;
 
-    DataListInsert(InitInfoList, GENERIC_DATA(pointer, NewEntry));
+    IntrusiveListInsert(InitInfoList, &(NewEntry->Link));
+    // A handler registered more than once is known by its' first registration
+    HashIndexInsert(InitInfoIndex, HANDLER_ID(Handler), NewEntry);
+
+    return NewEntry;
 }
 
-void RunInitializationFunctions(void) {
-    uint64_t HandlerAmmount;
-    CONSTRUCTOR_HANDLER* HandlerArray;
+/* Depth first topological sort. Dependencies are resolved through
+ *  InitInfoIndex so ordering takes O(handlers + dependencies)
+ */
+static OPAQUE_MEMORY OrganizeInitInformation(void) {
+    OPAQUE_MEMORY SerializedInitInfo;
+    INIT_INFORMATION** InfoArray;
+    INIT_INFORMATION* InitInfo;
+    uint64_t InsertedAmmount = 0;
 
-    // Organize handlers
-    OPAQUE_MEMORY SerializedInitHandlers = OrganizeInitInformation();
-    HandlerArray = SerializedInitHandlers.Data;
+    SetupOpaqueMemory(&SerializedInitInfo, InitInfoList->Length * sizeof(INIT_INFORMATION*));
+    InfoArray = OPAQUE_MEMORY_DATA(&SerializedInitInfo);
 
-    // Run all handlers
-    HandlerAmmount = SerializedInitHandlers.Size / sizeof(CONSTRUCTOR_HANDLER);
-    for(uint64_t HandlerInd = 0; HandlerInd != HandlerAmmount; HandlerInd++) {
-        HandlerArray[HandlerInd]();
+    ITERATE_INTRUSIVE_TYPE(InitInfoList, INIT_INFORMATION, Link, InitInfo) {
+        InitInfo->Ordered = FALSE;
+    }
+    
+    LOG_INFO("Handler order:");
+    ITERATE_INTRUSIVE_TYPE(InitInfoList, INIT_INFORMATION, Link, InitInfo) {
+        OrderHandler(InitInfo, InfoArray, &InsertedAmmount);
     }
 
-    // Release memory
-    ClearOpaqueMemory(&SerializedInitHandlers);
+    // All constructors must have been added
+    assert (InsertedAmmount == InitInfoList->Length);
+
+    return SerializedInitInfo;
+}
+
+/* Place the dependencies of `InitInfo` and then `InitInfo` in the run order */
+static void OrderHandler(INIT_INFORMATION* InitInfo, INIT_INFORMATION** InfoArray,
+                         uint64_t* InsertedAmmount) {
+    if (InitInfo->Ordered == TRUE) {
+        return;
+    }
+
+    // Reaching a handler whose dependencies are still being ordered is a cycle
+    if (InitInfo->Visiting == TRUE) {
+        LOG_ERROR("Dependency cycle through: %s", InitInfo->Location);
+        abort();
+    }
+    InitInfo->Visiting = TRUE;
+
+    uint64_t* DependencyArray = OPAQUE_MEMORY_DATA(InitInfo->Dependencies);
+    uint64_t DependencyAmmount = InitInfo->Dependencies->Size / sizeof(uint64_t);
+    for(uint64_t DependencyInd = 0; DependencyInd != DependencyAmmount; DependencyInd++) {
+        INIT_INFORMATION* Dependency = HashIndexFind(InitInfoIndex, DependencyArray[DependencyInd]);
+        if (Dependency == NULL) {
+            LOG_ERROR("Unregistered dependency of: %s", InitInfo->Location);
+            abort();
+        }
+        OrderHandler(Dependency, InfoArray, InsertedAmmount);
+    }
+
+    InitInfo->Visiting = FALSE;
+    InitInfo->Ordered  = TRUE;
+    InfoArray[(*InsertedAmmount)++] = InitInfo;
+
+    LOG_INFO("[%" PRIu64 "]: %s%s", *InsertedAmmount, InitInfo->Location,
+             (InitInfo->Flags & InitBackground) ? " (background)" : "");
+}
+
+static void ReleaseInitInfo(void) {
+    NO_DATA_ELEMENT* InitInfoLink;
+
+    while ((InitInfoLink = IntrusiveListPop(InitInfoList)) != NULL) {
+        INIT_INFORMATION* InitInfo = CONTAINER_OF(InitInfoLink, INIT_INFORMATION, Link);
+        Free(InitInfo->Location);
+        FreeOpaqueMemory(InitInfo->Dependencies);
+        Free(InitInfo);
+    }
+    FreeIntrusiveList(InitInfoList);
+    InitInfoList = NULL;
+    FreeHashIndex(InitInfoIndex);
+    InitInfoIndex = NULL;
+}
+
+/* Save the snapshot if needed and release everything used to initialize */
+static void FinishInitialization(void) {
+    SaveOutdatedSnapshot();
+
+    if (ProfilePath != NULL) {
+        SaveProfile();
+    }
+
+    ClearOpaqueMemory(&RunOrder);
+
+    if (SnapshotList != NULL) {
+        FreeMemoryList(SnapshotList);
+        SnapshotList = NULL;
+    }
 
     ReleaseInitInfo();
 }
 
-static OPAQUE_MEMORY OrganizeInitInformation(void) {
-    OPAQUE_MEMORY SerializedInitHandlers;
-    CONSTRUCTOR_HANDLER* HandlerArray;
+/* Save the snapshot if a handler with snapshot hooks had to run */
+static void SaveOutdatedSnapshot(void) {
     INIT_INFORMATION* InitInfo;
-    BOOLEAN AddedHandler = TRUE;
-    uint64_t InsertedAmmount = 0;
+    BOOLEAN SnapshotOutdated = FALSE;
 
-    SetupOpaqueMemory(&SerializedInitHandlers, InitInfoList->Length * sizeof(CONSTRUCTOR_HANDLER));
-    HandlerArray = SerializedInitHandlers.Data;
-    
-    printf("Handler order:\n");
-    while(AddedHandler == TRUE) {
-        AddedHandler = FALSE;
+    ITERATE_INTRUSIVE_TYPE(InitInfoList, INIT_INFORMATION, Link, InitInfo) {
+        if (InitInfo->SaveState != NULL && InitInfo->Completed == TRUE &&
+            InitInfo->Restored == FALSE) {
+            SnapshotOutdated = TRUE;
+        }
+    }
 
-        ITERATE_PRIMITIVE_DATA_TYPE(InitInfoList, pointer, InitInfo) {
-            if (InitInfo->Location == NULL) {
-                continue;
-            }
+    if (SnapshotOutdated == TRUE && SnapshotPath != NULL) {
+        SaveSnapshot();
+    }
+}
 
-            // Check if there are still dependencies not in the array
-            if (InitInfo->PendingDependencies == 0) {
-                HandlerArray[InsertedAmmount++] = InitInfo->Handler;
-                AddedHandler = TRUE;
+/* Move the registered snapshot hooks into their handlers' information and
+ *  point each handler to its' state in the snapshot, if any
+ */
+static void AttachSnapshotHooks(void) {
+    INIT_SNAPSHOT_HOOKS* Hooks;
+    INIT_INFORMATION* InitInfo;
 
-                printf("[%ld]: %s\n", InsertedAmmount, InitInfo->Location);
+    if (SnapshotHookList == NULL) {
+        return;
+    }
 
-                // Instead of removing from list we just "disable" it
-                Free(InitInfo->Location);
-                FreeOpaqueMemory(InitInfo->Dependencies);
-                InitInfo->Location = NULL;
-                InitInfo->Dependencies = NULL;
-            }
+    if (SnapshotPath != NULL && SnapshotList == NULL) {
+        SnapshotList = LoadSnapshot();
+    }
+
+    NO_DATA_ELEMENT* HooksLink;
+    while ((HooksLink = IntrusiveListPop(SnapshotHookList)) != NULL) {
+        Hooks = CONTAINER_OF(HooksLink, INIT_SNAPSHOT_HOOKS, Link);
+        InitInfo = HashIndexFind(InitInfoIndex, HANDLER_ID(Hooks->Handler));
+        if (InitInfo != NULL) {
+            InitInfo->SaveState    = Hooks->Save;
+            InitInfo->RestoreState = Hooks->Restore;
         }
+        Free(Hooks);
+    }
+    FreeIntrusiveList(SnapshotHookList);
+    SnapshotHookList = NULL;
 
-        // Update pending dependencies
-        ITERATE_PRIMITIVE_DATA_TYPE(InitInfoList, pointer, InitInfo) {
-            if (InitInfo->Dependencies == NULL) {
-                continue;
+    if (SnapshotList == NULL) {
+        return;
+    }
+
+    // Skip the build ID, then go through Location/State pairs
+    MEMORY_DATA_ELEMENT* Location = ((MEMORY_DATA_ELEMENT*)SnapshotList->Head)->Next;
+    while (Location != NULL && Location->Next != NULL) {
+        MEMORY_DATA_ELEMENT* State = Location->Next;
+
+        ITERATE_INTRUSIVE_TYPE(InitInfoList, INIT_INFORMATION, Link, InitInfo) {
+            if (InitInfo->RestoreState != NULL &&
+                Location->Memory.Size == Strlen(InitInfo->Location) + 1 &&
+                memcmp(OPAQUE_MEMORY_DATA(&Location->Memory), InitInfo->Location, Location->Memory.Size) == 0) {
+                InitInfo->SnapshotState = CLOAK_MEMORY(State->Memory.Size, FALSE,
+                                                       OPAQUE_MEMORY_DATA(&State->Memory));
             }
-            InitInfo->PendingDependencies = InitInfo->Dependencies->Size/sizeof(CONSTRUCTOR_HANDLER);
-            for(uint64_t HandlerInd = 0; HandlerInd != InsertedAmmount; HandlerInd++) {
-                if (HandlerDependsOn(InitInfo, HandlerArray[HandlerInd]) == TRUE) {
-                    InitInfo->PendingDependencies--;
-                }
+        }
+        Location = State->Next;
+    }
+}
+
+static int FindBuildID(struct dl_phdr_info* Info, size_t Size, void* _BuildID) {
+    (void)Size;
+    OPAQUE_MEMORY* BuildID = _BuildID;
+
+    // The first object is the executable itself
+    for (int HeaderInd = 0; HeaderInd != Info->dlpi_phnum; HeaderInd++) {
+        const ElfW(Phdr)* Header = &(Info->dlpi_phdr[HeaderInd]);
+        if (Header->p_type != PT_NOTE) {
+            continue;
+        }
+
+        uint8_t* Note = (uint8_t*)(Info->dlpi_addr + Header->p_vaddr);
+        uint8_t* NoteEnd = Note + Header->p_memsz;
+        while (Note + sizeof(ElfW(Nhdr)) <= NoteEnd) {
+            ElfW(Nhdr)* NoteHeader = (ElfW(Nhdr)*)Note;
+            uint8_t* Name = Note + sizeof(ElfW(Nhdr));
+            uint8_t* Descriptor = Name + ((NoteHeader->n_namesz + 3) & ~3U);
+
+            if (NoteHeader->n_type == NT_GNU_BUILD_ID &&
+                NoteHeader->n_namesz == sizeof("GNU") &&
+                memcmp(Name, "GNU", sizeof("GNU")) == 0) {
+                *BuildID = DuplicateIntoOpaqueMemory(Descriptor, NoteHeader->n_descsz);
+                return 1;
             }
+            Note = Descriptor + ((NoteHeader->n_descsz + 3) & ~3U);
         }
     }
+    return 1;
+}
 
-    // All constructors must have been added
-    assert (InsertedAmmount == InitInfoList->Length);
+/* Identify the running build: GNU build ID if present, build time if not */
+static OPAQUE_MEMORY GetBuildID(void) {
+    OPAQUE_MEMORY BuildID = CLOAK_MEMORY(0, FALSE, NULL);
+
+    dl_iterate_phdr(FindBuildID, &BuildID);
 
-    return SerializedInitHandlers;
+    if (BuildID.Size == 0) {
+        const char BuildTime[] = __DATE__ " " __TIME__;
+        BuildID = DuplicateIntoOpaqueMemory(BuildTime, sizeof(BuildTime));
+    }
+    return BuildID;
 }
 
-static BOOLEAN HandlerDependsOn(INIT_INFORMATION* InitInfo, CONSTRUCTOR_HANDLER Dependency) {
-    CONSTRUCTOR_HANDLER* HandlerArray = InitInfo->Dependencies->Data;
+/* Load the snapshot at SnapshotPath
+ * Returns NULL if there is none or it was taken by a different build
+ */
+static LIST* LoadSnapshot(void) {
+    FILE* File = fopen(SnapshotPath, "rb");
+    OPAQUE_MEMORY Contents = CLOAK_MEMORY(0, FALSE, NULL);
+    uint8_t Buffer[4096];
+    size_t ReadAmmount;
+    LIST* Snapshot = NULL;
+
+    if (File == NULL) {
+        return NULL;
+    }
+    while ((ReadAmmount = fread(Buffer, 1, sizeof(Buffer), File)) != 0) {
+        AppendRawMemory(&Contents, Buffer, ReadAmmount);
+    }
+    fclose(File);
+
+    // Truncated, corrupted or foreign snapshots fail the frame checks
+    Snapshot = DeSerializeMemoryListFramed(&Contents);
+    ClearOpaqueMemory(&Contents);
 
-    uint64_t HandlerAmmount = InitInfo->Dependencies->Size / sizeof(CONSTRUCTOR_HANDLER);
-    for(uint64_t HandlerInd = 0; HandlerInd != HandlerAmmount; HandlerInd++) {
-        if (HandlerArray[HandlerInd] == Dependency) {
-            return TRUE;
+    if (Snapshot == NULL) {
+        return NULL;
+    }
+    if (Snapshot->Length == 0) {
+        FreeMemoryList(Snapshot);
+        return NULL;
+    }
+
+    // Only trust snapshots taken by this exact build
+    OPAQUE_MEMORY BuildID = GetBuildID();
+    OPAQUE_MEMORY* SnapshotID = &(((MEMORY_DATA_ELEMENT*)Snapshot->Head)->Memory);
+    if (SnapshotID->Size != BuildID.Size ||
+        memcmp(OPAQUE_MEMORY_DATA(SnapshotID), OPAQUE_MEMORY_DATA(&BuildID), BuildID.Size) != 0) {
+        FreeMemoryList(Snapshot);
+        Snapshot = NULL;
+    }
+    ClearOpaqueMemory(&BuildID);
+
+    return Snapshot;
+}
+
+/* Store the state of every handler with snapshot hooks into SnapshotPath */
+static void SaveSnapshot(void) {
+    INIT_INFORMATION* InitInfo;
+    LIST* Snapshot = AllocateList();
+
+    MemoryListInsert(Snapshot, GetBuildID());
+
+    ITERATE_INTRUSIVE_TYPE(InitInfoList, INIT_INFORMATION, Link, InitInfo) {
+        // Handlers that didn't run (yet) have no state to save
+        if (InitInfo->SaveState == NULL || InitInfo->Completed == FALSE) {
+            continue;
+        }
+        OPAQUE_MEMORY* State = InitInfo->SaveState();
+        if (State == NULL) {
+            continue;
         }
+        MemoryListInsert(Snapshot, DuplicateIntoOpaqueMemory(InitInfo->Location,
+                                                             Strlen(InitInfo->Location) + 1));
+        MemoryListInsert(Snapshot, *State);
+        // The list now owns the state data
+        Free(State);
     }
-    return FALSE;
+
+    OPAQUE_MEMORY* Serialized = SerializeMemoryListFramed(Snapshot);
+    FreeMemoryList(Snapshot);
+
+    // Write aside and rename so a crash never leaves a partial snapshot
+    size_t PathSize = Strlen(SnapshotPath);
+    char* TemporaryPath = Malloc(PathSize + sizeof(".tmp"));
+    Memcpy(TemporaryPath, SnapshotPath, PathSize);
+    Memcpy(TemporaryPath + PathSize, ".tmp", sizeof(".tmp"));
+
+    FILE* File = fopen(TemporaryPath, "wb");
+    if (File != NULL) {
+        size_t Written = fwrite(OPAQUE_MEMORY_DATA(Serialized), 1, Serialized->Size, File);
+        if (fclose(File) == 0 && Written == Serialized->Size) {
+            rename(TemporaryPath, SnapshotPath);
+        } else {
+            remove(TemporaryPath);
+        }
+    }
+
+    Free(TemporaryPath);
+    FreeOpaqueMemory(Serialized);
 }
 
-static void ReleaseInitInfo(void) {
+static uint64_t GetTime(void) {
+    struct timespec Now;
+
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    return (uint64_t)Now.tv_sec * 1000000000 + (uint64_t)Now.tv_nsec;
+}
+
+/* Store how long each handler that ran took into ProfilePath */
+static void SaveProfile(void) {
     INIT_INFORMATION* InitInfo;
+    FILE* File = fopen(ProfilePath, "w");
 
-    ITERATE_PRIMITIVE_DATA_TYPE(InitInfoList, pointer, InitInfo) {
-        Free(InitInfo);
+    if (File == NULL) {
+        return;
     }
-    FreeDataList(InitInfoList);
-}
\ No newline at end of file
+
+    ITERATE_INTRUSIVE_TYPE(InitInfoList, INIT_INFORMATION, Link, InitInfo) {
+        if (InitInfo->Completed == TRUE) {
+            fprintf(File, "%" PRIu64 "\t%s\n", InitInfo->Duration / 1000, InitInfo->Location);
+        }
+    }
+    fclose(File);
+}
+
+/* Set the handlers' durations from a profile written by SaveProfile */
+static BOOLEAN LoadProfile(const char* Path) {
+    INIT_INFORMATION* InitInfo;
+    FILE* File = fopen(Path, "r");
+    char* Line = NULL;
+    size_t LineSize = 0;
+    ssize_t LineLength;
+
+    if (File == NULL) {
+        return FALSE;
+    }
+
+    HASH_INDEX* Locations = AllocateHashIndex(InitInfoList->Length);
+    ITERATE_INTRUSIVE_TYPE(InitInfoList, INIT_INFORMATION, Link, InitInfo) {
+        HashIndexInsert(Locations, HashName(InitInfo->Location), InitInfo);
+    }
+
+    while ((LineLength = getline(&Line, &LineSize, File)) != -1) {
+        uint64_t Microseconds;
+        int Offset = 0;
+
+        if (sscanf(Line, "%" SCNu64 "%n", &Microseconds, &Offset) != 1 ||
+            Line[Offset] != '\t') {
+            continue;
+        }
+        char* Location = Line + Offset + 1;
+        if (LineLength != 0 && Line[LineLength - 1] == '\n') {
+            Line[LineLength - 1] = '\0';
+        }
+
+        InitInfo = HashIndexFind(Locations, HashName(Location));
+        if (InitInfo != NULL && strcmp(InitInfo->Location, Location) == 0) {
+            InitInfo->Duration = Microseconds * 1000;
+        }
+    }
+
+    free(Line);
+    FreeHashIndex(Locations);
+    fclose(File);
+    return TRUE;
+}
@@ -0,0 +1,319 @@
+#include "InitSimulation.h"
+
+// Dependencies set to REMOVED_DEPENDENCY are ignored (what-if analysis)
+#define REMOVED_DEPENDENCY SIZE_MAX
+
+#define DEPENDENCY_AMMOUNT(Handler) ((Handler)->Dependencies.Size / sizeof(size_t))
+
+#define NANOSECONDS_TO_MICROSECONDS(Time) ((double)(Time) / 1000.0)
+
+// Amount of dependencies worth breaking reported
+#define REPORTED_DEPENDENCIES 5
+
+TYPE_STRUCT(DEPENDENCY_GAIN) {
+    size_t   Dependent;
+    size_t   Dependency;
+    uint64_t Makespan;
+};
+
+static const char* PolicyNames[SimulationPolicyAmmount] = {
+    [SimulateInOrder]           = "In order",
+    [SimulateCriticalPathFirst] = "Critical path first",
+    [SimulateLongestFirst]      = "Longest first",
+    [SimulateShortestFirst]     = "Shortest first",
+};
+
+static size_t* SetupSuccessors(const SIMULATED_HANDLER* Handlers, size_t Ammount,
+                               size_t** Offsets);
+
+static void SetDependency(SIMULATED_HANDLER* Handler, size_t Dependency, size_t Value);
+
+uint64_t SimulateMakespan(const SIMULATED_HANDLER* Handlers, size_t Ammount,
+                          uint32_t Cores, SIMULATION_POLICY Policy) {
+    SANITY_CHECK( Assert(Cores != 0 && Policy < SimulationPolicyAmmount) );
+
+    if (Ammount == 0) {
+        return 0;
+    }
+
+    size_t*   Offsets;
+    size_t*   Successors = SetupSuccessors(Handlers, Ammount, &Offsets);
+    size_t*   Remaining  = Malloc(Ammount * sizeof(size_t));
+    uint64_t* Priority   = Malloc(Ammount * sizeof(uint64_t));
+    uint64_t* Finish     = Malloc(Ammount * sizeof(uint64_t));
+    // 0: waiting on dependencies, 1: ready, 2: running, 3: done
+    uint8_t*  State      = Malloc(Ammount);
+
+    // Higher priority starts first, ties go to the lowest index
+    for (size_t HandlerInd = Ammount; HandlerInd-- != 0; ) {
+        const SIMULATED_HANDLER* Handler = &Handlers[HandlerInd];
+        uint64_t LongestSuccessor = 0;
+
+        switch (Policy) {
+            case SimulateInOrder:
+                Priority[HandlerInd] = Ammount - HandlerInd;
+                break;
+            case SimulateCriticalPathFirst:
+                // Successors have higher indexes, so their priority is set
+                for (size_t Ind = Offsets[HandlerInd]; Ind != Offsets[HandlerInd + 1]; Ind++) {
+                    if (Priority[Successors[Ind]] > LongestSuccessor) {
+                        LongestSuccessor = Priority[Successors[Ind]];
+                    }
+                }
+                Priority[HandlerInd] = Handler->Duration + LongestSuccessor;
+                break;
+            case SimulateLongestFirst:
+                Priority[HandlerInd] = Handler->Duration;
+                break;
+            default:
+                Priority[HandlerInd] = UINT64_MAX - Handler->Duration;
+                break;
+        }
+
+        const size_t* DependencyArray = OPAQUE_MEMORY_DATA(&Handler->Dependencies);
+        Remaining[HandlerInd] = 0;
+        for (size_t Ind = 0; Ind != DEPENDENCY_AMMOUNT(Handler); Ind++) {
+            if (DependencyArray[Ind] != REMOVED_DEPENDENCY) {
+                Remaining[HandlerInd]++;
+            }
+        }
+        State[HandlerInd] = (Remaining[HandlerInd] == 0) ? 1 : 0;
+    }
+
+    uint64_t Time = 0;
+    uint32_t Running = 0;
+    size_t   DoneAmmount = 0;
+
+    while (DoneAmmount != Ammount) {
+        // Fill the idle cores
+        while (Running != Cores) {
+            size_t Picked = Ammount;
+            for (size_t HandlerInd = 0; HandlerInd != Ammount; HandlerInd++) {
+                if (State[HandlerInd] == 1 &&
+                    (Picked == Ammount || Priority[HandlerInd] > Priority[Picked])) {
+                    Picked = HandlerInd;
+                }
+            }
+            if (Picked == Ammount) {
+                break;
+            }
+            State[Picked]  = 2;
+            Finish[Picked] = Time + Handlers[Picked].Duration;
+            Running++;
+        }
+
+        // Advance to the next handler to finish
+        uint64_t NextTime = UINT64_MAX;
+        for (size_t HandlerInd = 0; HandlerInd != Ammount; HandlerInd++) {
+            if (State[HandlerInd] == 2 && Finish[HandlerInd] < NextTime) {
+                NextTime = Finish[HandlerInd];
+            }
+        }
+        Time = NextTime;
+
+        for (size_t HandlerInd = 0; HandlerInd != Ammount; HandlerInd++) {
+            if (State[HandlerInd] != 2 || Finish[HandlerInd] != Time) {
+                continue;
+            }
+            State[HandlerInd] = 3;
+            Running--;
+            DoneAmmount++;
+            for (size_t Ind = Offsets[HandlerInd]; Ind != Offsets[HandlerInd + 1]; Ind++) {
+                if (--Remaining[Successors[Ind]] == 0) {
+                    State[Successors[Ind]] = 1;
+                }
+            }
+        }
+    }
+
+    Free(Offsets);
+    Free(Successors);
+    Free(Remaining);
+    Free(Priority);
+    Free(Finish);
+    Free(State);
+
+    return Time;
+}
+
+uint64_t CriticalPath(const SIMULATED_HANDLER* Handlers, size_t Ammount,
+                      OPAQUE_MEMORY* Path) {
+    if (Ammount == 0) {
+        if (Path != NULL) {
+            SetupOpaqueMemory(Path, 0);
+        }
+        return 0;
+    }
+
+    // Earliest finish of each handler, and the dependency that delays it
+    uint64_t* Finish      = Malloc(Ammount * sizeof(uint64_t));
+    size_t*   Predecessor = Malloc(Ammount * sizeof(size_t));
+    size_t    Last = 0;
+    uint64_t  Length = 0;
+
+    for (size_t HandlerInd = 0; HandlerInd != Ammount; HandlerInd++) {
+        const SIMULATED_HANDLER* Handler = &Handlers[HandlerInd];
+        const size_t* DependencyArray = OPAQUE_MEMORY_DATA(&Handler->Dependencies);
+        uint64_t Start = 0;
+
+        Predecessor[HandlerInd] = REMOVED_DEPENDENCY;
+        for (size_t Ind = 0; Ind != DEPENDENCY_AMMOUNT(Handler); Ind++) {
+            size_t Dependency = DependencyArray[Ind];
+            if (Dependency != REMOVED_DEPENDENCY && Finish[Dependency] > Start) {
+                Start = Finish[Dependency];
+                Predecessor[HandlerInd] = Dependency;
+            }
+        }
+        Finish[HandlerInd] = Start + Handler->Duration;
+        if (Finish[HandlerInd] > Length) {
+            Length = Finish[HandlerInd];
+            Last = HandlerInd;
+        }
+    }
+
+    if (Path != NULL) {
+        size_t PathLength = 0;
+        for (size_t HandlerInd = Last; HandlerInd != REMOVED_DEPENDENCY;
+             HandlerInd = Predecessor[HandlerInd]) {
+            PathLength++;
+        }
+
+        SetupOpaqueMemory(Path, PathLength * sizeof(size_t));
+        size_t* PathArray = OPAQUE_MEMORY_DATA(Path);
+        for (size_t HandlerInd = Last; HandlerInd != REMOVED_DEPENDENCY;
+             HandlerInd = Predecessor[HandlerInd]) {
+            PathArray[--PathLength] = HandlerInd;
+        }
+    }
+
+    Free(Finish);
+    Free(Predecessor);
+
+    return Length;
+}
+
+void ReportSimulation(SIMULATED_HANDLER* Handlers, size_t Ammount, uint32_t Cores) {
+    uint64_t Sequential = 0;
+    OPAQUE_MEMORY Path;
+
+    for (size_t HandlerInd = 0; HandlerInd != Ammount; HandlerInd++) {
+        Sequential += Handlers[HandlerInd].Duration;
+    }
+
+    printf("Simulated initialization of %zu handlers on %u cores:\n", Ammount, Cores);
+    printf("  %-20s %12.1f us\n", "Sequential", NANOSECONDS_TO_MICROSECONDS(Sequential));
+    uint64_t CriticalPathLength = CriticalPath(Handlers, Ammount, &Path);
+    printf("  %-20s %12.1f us\n", "Critical path", NANOSECONDS_TO_MICROSECONDS(CriticalPathLength));
+    for (int Policy = 0; Policy != SimulationPolicyAmmount; Policy++) {
+        uint64_t Makespan = SimulateMakespan(Handlers, Ammount, Cores, Policy);
+        printf("  %-20s %12.1f us\n", PolicyNames[Policy], NANOSECONDS_TO_MICROSECONDS(Makespan));
+    }
+
+    size_t* PathArray = OPAQUE_MEMORY_DATA(&Path);
+    size_t PathLength = Path.Size / sizeof(size_t);
+
+    printf("Critical path:\n");
+    for (size_t PathInd = 0; PathInd != PathLength; PathInd++) {
+        const SIMULATED_HANDLER* Handler = &Handlers[PathArray[PathInd]];
+        printf("  %12.1f us  %s\n", NANOSECONDS_TO_MICROSECONDS(Handler->Duration),
+               Handler->Location);
+    }
+
+    // Only dependencies along the critical path can shorten it
+    uint64_t Baseline = SimulateMakespan(Handlers, Ammount, Cores, SimulateCriticalPathFirst);
+    DEPENDENCY_GAIN Best[REPORTED_DEPENDENCIES];
+    size_t BestAmmount = 0;
+
+    for (size_t PathInd = 1; PathInd < PathLength; PathInd++) {
+        DEPENDENCY_GAIN Candidate = {
+            .Dependent  = PathArray[PathInd],
+            .Dependency = PathArray[PathInd - 1],
+        };
+
+        SetDependency(&Handlers[Candidate.Dependent], Candidate.Dependency, REMOVED_DEPENDENCY);
+        Candidate.Makespan = SimulateMakespan(Handlers, Ammount, Cores, SimulateCriticalPathFirst);
+        SetDependency(&Handlers[Candidate.Dependent], REMOVED_DEPENDENCY, Candidate.Dependency);
+
+        if (Candidate.Makespan >= Baseline) {
+            continue;
+        }
+
+        // Keep the best ones, sorted by resulting makespan
+        size_t Position = BestAmmount;
+        while (Position != 0 && Best[Position - 1].Makespan > Candidate.Makespan) {
+            if (Position != REPORTED_DEPENDENCIES) {
+                Best[Position] = Best[Position - 1];
+            }
+            Position--;
+        }
+        if (Position != REPORTED_DEPENDENCIES) {
+            Best[Position] = Candidate;
+            if (BestAmmount != REPORTED_DEPENDENCIES) {
+                BestAmmount++;
+            }
+        }
+    }
+
+    printf("Dependencies worth breaking (critical path first):\n");
+    if (BestAmmount == 0) {
+        printf("  none\n");
+    }
+    for (size_t BestInd = 0; BestInd != BestAmmount; BestInd++) {
+        printf("  %12.1f us  %s\n",
+               NANOSECONDS_TO_MICROSECONDS(Baseline - Best[BestInd].Makespan),
+               Handlers[Best[BestInd].Dependent].Location);
+        printf("  %15s on %s\n", "depending", Handlers[Best[BestInd].Dependency].Location);
+    }
+
+    ClearOpaqueMemory(&Path);
+}
+
+/* Compressed lists of the handlers that depend on each handler. The ones
+ *  depending on handler `X` are in [Offsets[X], Offsets[X + 1])
+ */
+static size_t* SetupSuccessors(const SIMULATED_HANDLER* Handlers, size_t Ammount,
+                               size_t** Offsets) {
+    size_t* SuccessorOffsets = Malloc((Ammount + 1) * sizeof(size_t));
+    size_t* Successors;
+
+    memset(SuccessorOffsets, 0, (Ammount + 1) * sizeof(size_t));
+
+    for (size_t HandlerInd = 0; HandlerInd != Ammount; HandlerInd++) {
+        const size_t* DependencyArray = OPAQUE_MEMORY_DATA(&Handlers[HandlerInd].Dependencies);
+        for (size_t Ind = 0; Ind != DEPENDENCY_AMMOUNT(&Handlers[HandlerInd]); Ind++) {
+            if (DependencyArray[Ind] != REMOVED_DEPENDENCY) {
+                SuccessorOffsets[DependencyArray[Ind] + 1]++;
+            }
+        }
+    }
+    for (size_t HandlerInd = 0; HandlerInd != Ammount; HandlerInd++) {
+        SuccessorOffsets[HandlerInd + 1] += SuccessorOffsets[HandlerInd];
+    }
+
+    Successors = Malloc((SuccessorOffsets[Ammount] + 1) * sizeof(size_t));
+    size_t* Cursor = DuplicateGenericMemory(SuccessorOffsets, Ammount * sizeof(size_t));
+
+    for (size_t HandlerInd = 0; HandlerInd != Ammount; HandlerInd++) {
+        const size_t* DependencyArray = OPAQUE_MEMORY_DATA(&Handlers[HandlerInd].Dependencies);
+        for (size_t Ind = 0; Ind != DEPENDENCY_AMMOUNT(&Handlers[HandlerInd]); Ind++) {
+            if (DependencyArray[Ind] != REMOVED_DEPENDENCY) {
+                Successors[Cursor[DependencyArray[Ind]]++] = HandlerInd;
+            }
+        }
+    }
+    Free(Cursor);
+
+    *Offsets = SuccessorOffsets;
+    return Successors;
+}
+
+/* Replace every `Dependency` of `Handler` with `Value` */
+static void SetDependency(SIMULATED_HANDLER* Handler, size_t Dependency, size_t Value) {
+    size_t* DependencyArray = OPAQUE_MEMORY_DATA(&Handler->Dependencies);
+
+    for (size_t Ind = 0; Ind != DEPENDENCY_AMMOUNT(Handler); Ind++) {
+        if (DependencyArray[Ind] == Dependency) {
+            DependencyArray[Ind] = Value;
+        }
+    }
+}
@@ -0,0 +1,398 @@
+#include <pthread.h>
+#include <unistd.h>
+
+#include "ListParallel.h"
+
+// Chunks given to each participant when no GrainSize is provided
+#define CHUNKS_PER_PARTICIPANT 8
+
+/* The payload is found at the same offset for Data and Memory elements */
+_Static_assert(offsetof(PRIMITIVE_DATA_ELEMENT, Data) ==
+               offsetof(MEMORY_DATA_ELEMENT, Memory),
+               "List payloads must share the same offset");
+
+#define ELEMENT_PAYLOAD(Link) \
+((void*)((uint8_t*)(Link) + offsetof(PRIMITIVE_DATA_ELEMENT, Data)))
+
+TYPE_STRUCT(PARALLEL_JOB);
+
+/* Run `Ammount` elements starting at `Link`, the first being element `Index` */
+typedef void (*PARALLEL_CHUNK_HANDLER)(PARALLEL_JOB* Job, size_t Chunk,
+                                       NO_DATA_ELEMENT* Link, size_t Index,
+                                       size_t Ammount);
+
+TYPE_STRUCT(PARALLEL_JOB) {
+    PARALLEL_CHUNK_HANDLER RunChunk;
+    // First element of each chunk
+    NO_DATA_ELEMENT**   ChunkHeads;
+    size_t              ChunkAmmount;
+    size_t              GrainSize;
+    size_t              Length;
+    // Algorithm specific arguments
+    void*               Arguments;
+};
+
+/* Chunks [Begin, End) still to be run by a participant. The owner takes from
+ *  Begin, thieves take the upper half
+ */
+typedef struct __attribute__((aligned(64))) {
+    pthread_mutex_t Lock;
+    size_t          Begin;
+    size_t          End;
+}PARALLEL_RANGE;
+
+static pthread_once_t   PoolOnce        = PTHREAD_ONCE_INIT;
+static pthread_mutex_t  PoolLock        = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   PoolWake        = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t   PoolDone        = PTHREAD_COND_INITIALIZER;
+// Serializes jobs, the pool runs one at a time
+static pthread_mutex_t  JobLock         = PTHREAD_MUTEX_INITIALIZER;
+static size_t           PoolWorkers     = 0;
+static pthread_t        PoolThreads[LIST_PARALLEL_MAX_WORKERS];
+static PARALLEL_RANGE   PoolRanges[LIST_PARALLEL_MAX_WORKERS + 1];
+static PARALLEL_JOB*    PoolJob         = NULL;
+static uint64_t         PoolGeneration  = 0;
+static size_t           PoolActive      = 0;
+
+static __thread BOOLEAN InsideParallelJob = FALSE;
+
+static void RunParticipant(PARALLEL_JOB* Job, size_t Self) {
+    size_t Participants = PoolWorkers + 1;
+    PARALLEL_RANGE* Own = &PoolRanges[Self];
+
+    while (TRUE) {
+        size_t Chunk = SIZE_MAX;
+
+        pthread_mutex_lock(&Own->Lock);
+        if (Own->Begin != Own->End) {
+            Chunk = Own->Begin++;
+        }
+        pthread_mutex_unlock(&Own->Lock);
+
+        // Out of work, steal half of someone elses'
+        for (size_t Offset = 1; Chunk == SIZE_MAX && Offset != Participants; Offset++) {
+            PARALLEL_RANGE* Victim = &PoolRanges[(Self + Offset) % Participants];
+            size_t StolenBegin, StolenEnd;
+
+            pthread_mutex_lock(&Victim->Lock);
+            StolenEnd   = Victim->End;
+            StolenBegin = Victim->Begin + (Victim->End - Victim->Begin) / 2;
+            Victim->End = StolenBegin;
+            pthread_mutex_unlock(&Victim->Lock);
+
+            if (StolenBegin == StolenEnd) {
+                continue;
+            }
+
+            Chunk = StolenBegin;
+            pthread_mutex_lock(&Own->Lock);
+            Own->Begin = StolenBegin + 1;
+            Own->End   = StolenEnd;
+            pthread_mutex_unlock(&Own->Lock);
+        }
+
+        if (Chunk == SIZE_MAX) {
+            return;
+        }
+
+        size_t Index = Chunk * Job->GrainSize;
+        size_t Ammount = Job->Length - Index;
+        if (Ammount > Job->GrainSize) {
+            Ammount = Job->GrainSize;
+        }
+        Job->RunChunk(Job, Chunk, Job->ChunkHeads[Chunk], Index, Ammount);
+    }
+}
+
+static void* PoolWorker(void* _Self) {
+    size_t Self = (size_t)(uintptr_t)_Self;
+    uint64_t Seen = 0;
+
+    InsideParallelJob = TRUE;
+
+    while (TRUE) {
+        PARALLEL_JOB* Job;
+
+        pthread_mutex_lock(&PoolLock);
+        while (PoolGeneration == Seen) {
+            pthread_cond_wait(&PoolWake, &PoolLock);
+        }
+        Seen = PoolGeneration;
+        Job = PoolJob;
+        pthread_mutex_unlock(&PoolLock);
+
+        RunParticipant(Job, Self);
+
+        pthread_mutex_lock(&PoolLock);
+        PoolActive--;
+        if (PoolActive == 0) {
+            pthread_cond_signal(&PoolDone);
+        }
+        pthread_mutex_unlock(&PoolLock);
+    }
+    return NULL;
+}
+
+/* Pool threads don't survive a fork: the child starts its' own pool on its'
+ *  first job
+ */
+static void ResetPoolAfterFork(void) {
+    PoolOnce       = (pthread_once_t)PTHREAD_ONCE_INIT;
+    PoolLock       = (pthread_mutex_t)PTHREAD_MUTEX_INITIALIZER;
+    JobLock        = (pthread_mutex_t)PTHREAD_MUTEX_INITIALIZER;
+    PoolWake       = (pthread_cond_t)PTHREAD_COND_INITIALIZER;
+    PoolDone       = (pthread_cond_t)PTHREAD_COND_INITIALIZER;
+    PoolWorkers    = 0;
+    PoolJob        = NULL;
+    PoolGeneration = 0;
+    PoolActive     = 0;
+}
+
+static void StartPool(void) {
+    static BOOLEAN ForkHandlerRegistered = FALSE;
+    #ifdef LIST_PARALLEL_WORKERS
+    long Cores = LIST_PARALLEL_WORKERS + 1;
+    #else
+    long Cores = sysconf(_SC_NPROCESSORS_ONLN);
+    #endif
+    size_t Workers = (Cores > 1) ? (size_t)Cores - 1 : 0;
+
+    if (Workers > LIST_PARALLEL_MAX_WORKERS) {
+        Workers = LIST_PARALLEL_MAX_WORKERS;
+    }
+
+    if (ForkHandlerRegistered == FALSE) {
+        pthread_atfork(NULL, NULL, ResetPoolAfterFork);
+        ForkHandlerRegistered = TRUE;
+    }
+
+    for (size_t Participant = 0; Participant != LIST_PARALLEL_MAX_WORKERS + 1; Participant++) {
+        pthread_mutex_init(&PoolRanges[Participant].Lock, NULL);
+    }
+
+    for (size_t Worker = 0; Worker != Workers; Worker++) {
+        // Participant 0 is the calling thread
+        if (pthread_create(&PoolThreads[Worker], NULL, PoolWorker,
+                           (void*)(uintptr_t)(Worker + 1)) != 0) {
+            break;
+        }
+        PoolWorkers++;
+    }
+}
+
+/* Decide how `List` is split into chunks */
+static void PlanParallelJob(LIST* List, PARALLEL_JOB* Job, size_t GrainSize) {
+    SANITY_CHECK( AssertSaneList(List) );
+
+    pthread_once(&PoolOnce, StartPool);
+
+    size_t Participants = PoolWorkers + 1;
+
+    if (GrainSize == 0) {
+        GrainSize = List->Length / (Participants * CHUNKS_PER_PARTICIPANT);
+    }
+    // Nested or single threaded jobs run as a single chunk
+    if (GrainSize == 0 || InsideParallelJob == TRUE || Participants == 1) {
+        GrainSize = (List->Length != 0) ? List->Length : 1;
+    }
+
+    Job->Length       = List->Length;
+    Job->GrainSize    = GrainSize;
+    Job->ChunkAmmount = (List->Length + GrainSize - 1) / GrainSize;
+}
+
+/* Run all chunks of a planned job, in parallel when there are several */
+static void RunParallelJob(LIST* List, PARALLEL_JOB* Job) {
+    size_t Participants = PoolWorkers + 1;
+
+    if (Job->ChunkAmmount == 0) {
+        return;
+    }
+
+    if (Job->ChunkAmmount == 1) {
+        Job->RunChunk(Job, 0, List->Head, 0, Job->Length);
+        return;
+    }
+
+    // Record where each chunk starts
+    OPAQUE_MEMORY ChunkHeads;
+    SetupOpaqueMemory(&ChunkHeads, Job->ChunkAmmount * sizeof(NO_DATA_ELEMENT*));
+    Job->ChunkHeads = OPAQUE_MEMORY_DATA(&ChunkHeads);
+
+    NO_DATA_ELEMENT* Link = List->Head;
+    for (size_t Index = 0; Link != NULL; Index++, Link = Link->Next) {
+        if (Index % Job->GrainSize == 0) {
+            Job->ChunkHeads[Index / Job->GrainSize] = Link;
+        }
+    }
+
+    pthread_mutex_lock(&JobLock);
+
+    // Evenly distribute the chunks among participants
+    for (size_t Participant = 0; Participant != Participants; Participant++) {
+        PoolRanges[Participant].Begin = Job->ChunkAmmount * Participant / Participants;
+        PoolRanges[Participant].End   = Job->ChunkAmmount * (Participant + 1) / Participants;
+    }
+
+    pthread_mutex_lock(&PoolLock);
+    PoolJob    = Job;
+    PoolActive = PoolWorkers;
+    PoolGeneration++;
+    pthread_cond_broadcast(&PoolWake);
+    pthread_mutex_unlock(&PoolLock);
+
+    InsideParallelJob = TRUE;
+    RunParticipant(Job, 0);
+    InsideParallelJob = FALSE;
+
+    pthread_mutex_lock(&PoolLock);
+    while (PoolActive != 0) {
+        pthread_cond_wait(&PoolDone, &PoolLock);
+    }
+    PoolJob = NULL;
+    pthread_mutex_unlock(&PoolLock);
+
+    pthread_mutex_unlock(&JobLock);
+
+    ClearOpaqueMemory(&ChunkHeads);
+}
+
+//                          For each
+
+TYPE_STRUCT(FOR_EACH_ARGUMENTS) {
+    LIST_FOR_EACH_HANDLER   Handler;
+    void*                   Context;
+};
+
+static void ForEachChunk(PARALLEL_JOB* Job, size_t Chunk, NO_DATA_ELEMENT* Link,
+                         size_t Index, size_t Ammount) {
+    (void)Chunk;
+    (void)Index;
+    FOR_EACH_ARGUMENTS* Arguments = Job->Arguments;
+
+    for (; Ammount != 0; Ammount--, Link = Link->Next) {
+        Arguments->Handler(ELEMENT_PAYLOAD(Link), Arguments->Context);
+    }
+}
+
+void ListParallelForEach(LIST* List, LIST_FOR_EACH_HANDLER Handler,
+                         void* Context, size_t GrainSize) {
+    FOR_EACH_ARGUMENTS Arguments = {Handler, Context};
+    PARALLEL_JOB Job = {.RunChunk = ForEachChunk, .Arguments = &Arguments};
+
+    PlanParallelJob(List, &Job, GrainSize);
+    RunParallelJob(List, &Job);
+}
+
+//                          Map
+
+TYPE_STRUCT(MAP_ARGUMENTS) {
+    LIST_MAP_HANDLER    Handler;
+    void*               Context;
+    uint8_t*            Output;
+    size_t              OutputSize;
+};
+
+static void MapChunk(PARALLEL_JOB* Job, size_t Chunk, NO_DATA_ELEMENT* Link,
+                     size_t Index, size_t Ammount) {
+    (void)Chunk;
+    MAP_ARGUMENTS* Arguments = Job->Arguments;
+    uint8_t* Output = Arguments->Output + Index * Arguments->OutputSize;
+
+    for (; Ammount != 0; Ammount--, Link = Link->Next) {
+        Arguments->Handler(ELEMENT_PAYLOAD(Link), Output, Arguments->Context);
+        Output += Arguments->OutputSize;
+    }
+}
+
+OPAQUE_MEMORY* ListParallelMap(LIST* List, size_t OutputSize,
+                               LIST_MAP_HANDLER Handler, void* Context,
+                               size_t GrainSize) {
+    OPAQUE_MEMORY* Output = AllocateOpaqueMemory(List->Length * OutputSize);
+    MAP_ARGUMENTS Arguments = {Handler, Context, OPAQUE_MEMORY_DATA(Output), OutputSize};
+    PARALLEL_JOB Job = {.RunChunk = MapChunk, .Arguments = &Arguments};
+
+    PlanParallelJob(List, &Job, GrainSize);
+    RunParallelJob(List, &Job);
+
+    return Output;
+}
+
+TYPE_STRUCT(MEMORY_MAP_ARGUMENTS) {
+    LIST_MEMORY_MAP_HANDLER Handler;
+    void*                   Context;
+};
+
+static void MemoryMapElement(const void* Element, void* Output, void* Context) {
+    MEMORY_MAP_ARGUMENTS* Arguments = Context;
+
+    *(OPAQUE_MEMORY*)Output = Arguments->Handler(Element, Arguments->Context);
+}
+
+LIST* ListParallelMapToMemoryList(LIST* List, LIST_MEMORY_MAP_HANDLER Handler,
+                                  void* Context, size_t GrainSize) {
+    MEMORY_MAP_ARGUMENTS Arguments = {Handler, Context};
+    OPAQUE_MEMORY* Results;
+    OPAQUE_MEMORY* Result;
+    LIST* NewList = AllocateList();
+
+    Results = ListParallelMap(List, sizeof(OPAQUE_MEMORY), MemoryMapElement,
+                              &Arguments, GrainSize);
+
+    // The new list takes ownership of each result
+    Result = OPAQUE_MEMORY_DATA(Results);
+    for (size_t Index = 0; Index != List->Length; Index++) {
+        MemoryListInsert(NewList, Result[Index]);
+    }
+    FreeOpaqueMemory(Results);
+
+    return NewList;
+}
+
+//                          Reduce
+
+TYPE_STRUCT(REDUCE_ARGUMENTS) {
+    LIST_REDUCE_HANDLER Reduce;
+    void*               Context;
+    // One accumulator per chunk
+    uint8_t*            Partials;
+    size_t              AccumulatorSize;
+};
+
+static void ReduceChunk(PARALLEL_JOB* Job, size_t Chunk, NO_DATA_ELEMENT* Link,
+                        size_t Index, size_t Ammount) {
+    (void)Index;
+    REDUCE_ARGUMENTS* Arguments = Job->Arguments;
+    void* Partial = Arguments->Partials + Chunk * Arguments->AccumulatorSize;
+
+    for (; Ammount != 0; Ammount--, Link = Link->Next) {
+        Arguments->Reduce(Partial, ELEMENT_PAYLOAD(Link), Arguments->Context);
+    }
+}
+
+void ListParallelReduce(LIST* List, void* Accumulator, size_t AccumulatorSize,
+                        LIST_REDUCE_HANDLER Reduce, LIST_COMBINE_HANDLER Combine,
+                        void* Context, size_t GrainSize) {
+    SANITY_CHECK( Assert(Accumulator != NULL) );
+
+    REDUCE_ARGUMENTS Arguments = {Reduce, Context, NULL, AccumulatorSize};
+    PARALLEL_JOB Job = {.RunChunk = ReduceChunk, .Arguments = &Arguments};
+    OPAQUE_MEMORY Partials;
+
+    PlanParallelJob(List, &Job, GrainSize);
+
+    // Every chunk starts from the identity
+    SetupOpaqueMemory(&Partials, Job.ChunkAmmount * AccumulatorSize);
+    Arguments.Partials = OPAQUE_MEMORY_DATA(&Partials);
+    for (size_t Chunk = 0; Chunk != Job.ChunkAmmount; Chunk++) {
+        Memcpy(Arguments.Partials + Chunk * AccumulatorSize, Accumulator, AccumulatorSize);
+    }
+
+    RunParallelJob(List, &Job);
+
+    for (size_t Chunk = 0; Chunk != Job.ChunkAmmount; Chunk++) {
+        Combine(Accumulator, Arguments.Partials + Chunk * AccumulatorSize, Context);
+    }
+
+    ClearOpaqueMemory(&Partials);
+}
@@ -0,0 +1,470 @@
+#include "ListSort.h"
+
+/* The payload is found at the same offset for Data and Memory elements */
+_Static_assert(offsetof(PRIMITIVE_DATA_ELEMENT, Data) ==
+               offsetof(MEMORY_DATA_ELEMENT, Memory),
+               "List payloads must share the same offset");
+
+#define PAYLOAD_OFFSET offsetof(PRIMITIVE_DATA_ELEMENT, Data)
+
+// Enough pending runs for 2^64 elements
+#define MAXIMUM_RUNS 64
+
+// Data lists shorter than this are sorted by relinking, without scratch space
+#define SCRATCH_MINIMUM_LENGTH 64
+// Scratch runs of this length are insertion sorted before merging
+#define SCRATCH_RUN_LENGTH     16
+
+#define RADIX_BITS    8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES  (sizeof(uintptr_t) * 8 / RADIX_BITS)
+// More passes than this fall back to the merge sort
+#define RADIX_MAXIMUM_PASSES 1
+
+/* How elements of a list are compared */
+typedef struct {
+    LIST_COMPARE_HANDLER Compare;
+    void*                Context;
+    // Where the payload given to Compare is, from the start of the link
+    size_t               PayloadOffset;
+}LIST_ORDER;
+
+/* A Data payload copied next to its' link. Sorting these keeps comparisons on
+ *  contiguous memory instead of chasing links scattered over the heap
+ */
+typedef struct {
+    OPAQUE_DATA             Data;
+    PRIMITIVE_DATA_ELEMENT* Link;
+}SORT_ENTRY;
+
+/* Called with each element removed by DedupSortedLinks */
+typedef void (*LINK_RELEASE_HANDLER)(NO_DATA_ELEMENT* Link);
+
+static inline int CompareLinks(const LIST_ORDER* Order, NO_DATA_ELEMENT* Left,
+                               NO_DATA_ELEMENT* Right) {
+    return Order->Compare((uint8_t*)Left + Order->PayloadOffset,
+                          (uint8_t*)Right + Order->PayloadOffset,
+                          Order->Context);
+}
+
+int CompareUnsignedData(const void* Left, const void* Right, void* Context) {
+    (void)Context;
+    uintptr_t A = ((const OPAQUE_DATA*)Left)->Val_uintptr_t;
+    uintptr_t B = ((const OPAQUE_DATA*)Right)->Val_uintptr_t;
+
+    return (A > B) - (A < B);
+}
+
+int CompareSignedData(const void* Left, const void* Right, void* Context) {
+    (void)Context;
+    intptr_t A = ((const OPAQUE_DATA*)Left)->Val_intptr_t;
+    intptr_t B = ((const OPAQUE_DATA*)Right)->Val_intptr_t;
+
+    return (A > B) - (A < B);
+}
+
+int CompareMemoryData(const void* Left, const void* Right, void* Context) {
+    (void)Context;
+    return CompareOpaqueMemory((OPAQUE_MEMORY*)Left, (OPAQUE_MEMORY*)Right);
+}
+
+/* Merge the NULL terminated runs `Left` and `Right`, taking from `Left` on ties
+ * Returns the head of the merged run, its' last link is stored in `Tail`
+ */
+static NO_DATA_ELEMENT* MergeRuns(const LIST_ORDER* Order, NO_DATA_ELEMENT* Left,
+                                  NO_DATA_ELEMENT* LeftTail,
+                                  NO_DATA_ELEMENT* Right,
+                                  NO_DATA_ELEMENT* RightTail,
+                                  NO_DATA_ELEMENT** Tail) {
+    NO_DATA_ELEMENT Head = { .Next = NULL };
+    NO_DATA_ELEMENT* Last = &Head;
+
+    while (Left != NULL && Right != NULL) {
+        if (CompareLinks(Order, Right, Left) < 0) {
+            Last->Next = Right;
+            Right = Right->Next;
+        } else {
+            Last->Next = Left;
+            Left = Left->Next;
+        }
+        Last = Last->Next;
+    }
+
+    if (Left != NULL) {
+        Last->Next = Left;
+        Last = LeftTail;
+    } else if (Right != NULL) {
+        Last->Next = Right;
+        Last = RightTail;
+    }
+    *Tail = Last;
+    return Head.Next;
+}
+
+/* Bottom-up merge sort
+ * Runs[N] holds a sorted run of 2^N elements (or nothing). Each element is
+ *  added as a run of 1 and carried up like a binary counter, so merges work on
+ *  recently touched elements while they are still in cache
+ */
+static void SortLinks(LIST* List, const LIST_ORDER* Order) {
+    NO_DATA_ELEMENT* Runs[MAXIMUM_RUNS] = { NULL };
+    NO_DATA_ELEMENT* RunTails[MAXIMUM_RUNS];
+    NO_DATA_ELEMENT* Link = List->Head;
+    size_t TopRun = 0;
+
+    if (List->Length < 2) {
+        return;
+    }
+
+    while (Link != NULL) {
+        NO_DATA_ELEMENT* Carry = Link;
+        NO_DATA_ELEMENT* CarryTail = Link;
+        size_t Run;
+
+        Link = Link->Next;
+        Carry->Next = NULL;
+
+        // Runs hold earlier elements than Carry, so they go on the left
+        for (Run = 0; Runs[Run] != NULL; Run++) {
+            Carry = MergeRuns(Order, Runs[Run], RunTails[Run], Carry, CarryTail,
+                              &CarryTail);
+            Runs[Run] = NULL;
+        }
+        Runs[Run] = Carry;
+        RunTails[Run] = CarryTail;
+        if (Run > TopRun) {
+            TopRun = Run;
+        }
+    }
+
+    NO_DATA_ELEMENT* Sorted = NULL;
+    NO_DATA_ELEMENT* SortedTail = NULL;
+    for (size_t Run = 0; Run <= TopRun; Run++) {
+        if (Runs[Run] != NULL) {
+            Sorted = MergeRuns(Order, Runs[Run], RunTails[Run], Sorted, SortedTail,
+                               &SortedTail);
+        }
+    }
+
+    List->Head = Sorted;
+    List->Tail = SortedTail;
+}
+
+/* Stable insertion sort of `Length` entries */
+static void InsertionSortEntries(SORT_ENTRY* Entries, size_t Length,
+                                 LIST_COMPARE_HANDLER Compare, void* Context) {
+    for (size_t Ind = 1; Ind < Length; Ind++) {
+        SORT_ENTRY Entry = Entries[Ind];
+        size_t Position = Ind;
+
+        while (Position != 0 &&
+               Compare(&Entry.Data, &Entries[Position - 1].Data, Context) < 0) {
+            Entries[Position] = Entries[Position - 1];
+            Position--;
+        }
+        Entries[Position] = Entry;
+    }
+}
+
+/* Merge the sorted `Left` and `Right` entries into `Merged`, taking from
+ *  `Left` on ties
+ */
+static void MergeEntries(const SORT_ENTRY* Left, size_t LeftLength,
+                         const SORT_ENTRY* Right, size_t RightLength,
+                         SORT_ENTRY* Merged, LIST_COMPARE_HANDLER Compare,
+                         void* Context) {
+    const SORT_ENTRY* LeftEnd = Left + LeftLength;
+    const SORT_ENTRY* RightEnd = Right + RightLength;
+
+    while (Left != LeftEnd && Right != RightEnd) {
+        if (Compare(&Right->Data, &Left->Data, Context) < 0) {
+            *Merged++ = *Right++;
+        } else {
+            *Merged++ = *Left++;
+        }
+    }
+    while (Left != LeftEnd) {
+        *Merged++ = *Left++;
+    }
+    while (Right != RightEnd) {
+        *Merged++ = *Right++;
+    }
+}
+
+/* Sort a Data list by copying its' payloads into a scratch array, merge
+ *  sorting the array and relinking the elements in the sorted order
+ * Returns FALSE, leaving the list untouched, if the scratch array can't be
+ *  allocated
+ */
+static BOOLEAN SortDataLinksWithScratch(LIST* List, LIST_COMPARE_HANDLER Compare,
+                                        void* Context) {
+    size_t Length = List->Length;
+    SORT_ENTRY* Entries = Malloc(2 * Length * sizeof(SORT_ENTRY));
+    PRIMITIVE_DATA_ELEMENT* Link = List->Head;
+
+    if (Entries == NULL) {
+        return FALSE;
+    }
+    SORT_ENTRY* Scratch = Entries + Length;
+
+    for (size_t Ind = 0; Ind != Length; Ind++) {
+        Entries[Ind].Data = Link->Data;
+        Entries[Ind].Link = Link;
+        Link = Link->Next;
+    }
+
+    for (size_t Start = 0; Start < Length; Start += SCRATCH_RUN_LENGTH) {
+        size_t RunLength = (Length - Start < SCRATCH_RUN_LENGTH) ?
+                           Length - Start : SCRATCH_RUN_LENGTH;
+        InsertionSortEntries(Entries + Start, RunLength, Compare, Context);
+    }
+
+    // Runs are merged back and forth between both halves of the allocation
+    SORT_ENTRY* Sorted = Entries;
+    SORT_ENTRY* Merged = Scratch;
+    for (size_t Width = SCRATCH_RUN_LENGTH; Width < Length; Width *= 2) {
+        for (size_t Start = 0; Start < Length; Start += 2 * Width) {
+            size_t LeftLength = (Length - Start < Width) ? Length - Start : Width;
+            size_t RightLength = (Length - Start - LeftLength < Width) ?
+                                 Length - Start - LeftLength : Width;
+            MergeEntries(Sorted + Start, LeftLength, Sorted + Start + LeftLength,
+                         RightLength, Merged + Start, Compare, Context);
+        }
+        SORT_ENTRY* Swap = Sorted;
+        Sorted = Merged;
+        Merged = Swap;
+    }
+
+    for (size_t Ind = 0; Ind + 1 != Length; Ind++) {
+        Sorted[Ind].Link->Next = Sorted[Ind + 1].Link;
+    }
+    Sorted[Length - 1].Link->Next = NULL;
+    List->Head = Sorted[0].Link;
+    List->Tail = Sorted[Length - 1].Link;
+
+    Free(Entries);
+    return TRUE;
+}
+
+static void MergeSortedLinks(LIST* Into, LIST* From, const LIST_ORDER* Order) {
+    NO_DATA_ELEMENT* Tail;
+
+    if (From->Length == 0) {
+        return;
+    }
+
+    Into->Head = MergeRuns(Order, Into->Head, Into->Tail, From->Head, From->Tail,
+                           &Tail);
+    Into->Tail = Tail;
+    Into->Length += From->Length;
+
+    #ifdef ENABLE_SANITY_CHECKS
+    if (Into->InsertedTypes == NoDataType) {
+        Into->InsertedTypes = From->InsertedTypes;
+    }
+    #endif
+
+    From->Head   = NULL;
+    From->Tail   = NULL;
+    From->Length = 0;
+}
+
+static size_t DedupSortedLinks(LIST* List, const LIST_ORDER* Order,
+                               LINK_RELEASE_HANDLER Release) {
+    NO_DATA_ELEMENT* Kept = List->Head;
+    size_t Removed = 0;
+
+    if (Kept == NULL) {
+        return 0;
+    }
+
+    while (Kept->Next != NULL) {
+        NO_DATA_ELEMENT* Candidate = Kept->Next;
+        if (CompareLinks(Order, Kept, Candidate) == 0) {
+            Kept->Next = Candidate->Next;
+            Candidate->Next = NULL;
+            if (Release != NULL) {
+                Release(Candidate);
+            }
+            Removed++;
+        } else {
+            Kept = Candidate;
+        }
+    }
+
+    List->Tail = Kept;
+    List->Length -= Removed;
+    return Removed;
+}
+
+static void ReleaseDataLink(NO_DATA_ELEMENT* Link) {
+    Free(Link);
+}
+
+static void ReleaseMemoryLink(NO_DATA_ELEMENT* Link) {
+    ClearOpaqueMemory(&(((MEMORY_DATA_ELEMENT*)Link)->Memory));
+    Free(Link);
+}
+
+void SortDataList(LIST* List, LIST_COMPARE_HANDLER Compare, void* Context) {
+    SANITY_CHECK( AssertSaneDataList(List) );
+
+    if (List->Length < SCRATCH_MINIMUM_LENGTH ||
+        SortDataLinksWithScratch(List, Compare, Context) == FALSE) {
+        LIST_ORDER Order = { Compare, Context, PAYLOAD_OFFSET };
+        SortLinks(List, &Order);
+    }
+
+    SANITY_CHECK( AssertSaneDataList(List) );
+}
+
+void SortMemoryList(LIST* List, LIST_COMPARE_HANDLER Compare, void* Context) {
+    SANITY_CHECK( AssertSaneMemoryList(List) );
+
+    LIST_ORDER Order = { Compare, Context, PAYLOAD_OFFSET };
+    SortLinks(List, &Order);
+
+    SANITY_CHECK( AssertSaneMemoryList(List) );
+}
+
+void SortIntrusiveList(LIST* List, LIST_COMPARE_HANDLER Compare, void* Context) {
+    SANITY_CHECK( AssertSaneIntrusiveList(List) );
+
+    LIST_ORDER Order = { Compare, Context, 0 };
+    SortLinks(List, &Order);
+
+    SANITY_CHECK( AssertSaneIntrusiveList(List) );
+}
+
+/* Amount of radix passes needed, i.e. of key bytes that differ in `Differ` */
+static size_t RadixPassAmmount(uintptr_t Differ) {
+    size_t PassAmmount = 0;
+
+    for (size_t Pass = 0; Pass != RADIX_PASSES; Pass++) {
+        PassAmmount += ((Differ >> (Pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)) != 0;
+    }
+    return PassAmmount;
+}
+
+void RadixSortDataList(LIST* List, BOOLEAN Signed) {
+    SANITY_CHECK( AssertSaneDataList(List) );
+
+    // Flipping the sign bit orders intptr_t values as unsigned ones
+    uintptr_t Flip = (Signed == TRUE) ? (uintptr_t)1 << (sizeof(uintptr_t) * 8 - 1) : 0;
+    PRIMITIVE_DATA_ELEMENT* Link;
+
+    if (List->Length < 2) {
+        return;
+    }
+
+    // Bits set in Differ are those where some key differs from the first one.
+    //  Bytes that never differ don't need a pass
+    uintptr_t FirstKey = ((PRIMITIVE_DATA_ELEMENT*)List->Head)->Data.Val_uintptr_t;
+    uintptr_t Differ = 0;
+    for (Link = List->Head; Link != NULL; Link = Link->Next) {
+        uintptr_t Seen = Differ;
+        Differ |= Link->Data.Val_uintptr_t ^ FirstKey;
+        // Every pass scatters the whole list, past one of them merging is
+        //  faster. Stop looking as soon as that is known
+        if (Differ != Seen && RadixPassAmmount(Differ) > RADIX_MAXIMUM_PASSES) {
+            SortDataList(List, (Signed == TRUE) ? CompareSignedData : CompareUnsignedData,
+                         NULL);
+            return;
+        }
+    }
+
+    for (size_t Pass = 0; Pass != RADIX_PASSES; Pass++) {
+        unsigned Shift = (unsigned)(Pass * RADIX_BITS);
+        if (((Differ >> Shift) & (RADIX_BUCKETS - 1)) == 0) {
+            continue;
+        }
+
+        PRIMITIVE_DATA_ELEMENT* BucketHeads[RADIX_BUCKETS] = { NULL };
+        PRIMITIVE_DATA_ELEMENT* BucketTails[RADIX_BUCKETS];
+
+        // Appending keeps equal bytes in their' current order, which is what
+        //  makes the sort stable
+        Link = List->Head;
+        while (Link != NULL) {
+            PRIMITIVE_DATA_ELEMENT* Next = Link->Next;
+            size_t Bucket = ((Link->Data.Val_uintptr_t ^ Flip) >> Shift) & (RADIX_BUCKETS - 1);
+
+            if (Next != NULL) {
+                __builtin_prefetch(Next->Next);
+            }
+            if (BucketHeads[Bucket] == NULL) {
+                BucketHeads[Bucket] = Link;
+            } else {
+                BucketTails[Bucket]->Next = Link;
+            }
+            BucketTails[Bucket] = Link;
+            Link = Next;
+        }
+
+        PRIMITIVE_DATA_ELEMENT Head = { .Next = NULL };
+        PRIMITIVE_DATA_ELEMENT* Last = &Head;
+        for (size_t Bucket = 0; Bucket != RADIX_BUCKETS; Bucket++) {
+            if (BucketHeads[Bucket] != NULL) {
+                Last->Next = BucketHeads[Bucket];
+                Last = BucketTails[Bucket];
+            }
+        }
+        Last->Next = NULL;
+
+        List->Head = Head.Next;
+        List->Tail = Last;
+    }
+
+    SANITY_CHECK( AssertSaneDataList(List) );
+}
+
+void MergeSortedDataLists(LIST* Into, LIST* From, LIST_COMPARE_HANDLER Compare,
+                          void* Context) {
+    SANITY_CHECK( AssertSaneDataList(Into) );
+    SANITY_CHECK( AssertSaneDataList(From) );
+
+    LIST_ORDER Order = { Compare, Context, PAYLOAD_OFFSET };
+    MergeSortedLinks(Into, From, &Order);
+}
+
+void MergeSortedMemoryLists(LIST* Into, LIST* From, LIST_COMPARE_HANDLER Compare,
+                            void* Context) {
+    SANITY_CHECK( AssertSaneMemoryList(Into) );
+    SANITY_CHECK( AssertSaneMemoryList(From) );
+
+    LIST_ORDER Order = { Compare, Context, PAYLOAD_OFFSET };
+    MergeSortedLinks(Into, From, &Order);
+}
+
+void MergeSortedIntrusiveLists(LIST* Into, LIST* From,
+                               LIST_COMPARE_HANDLER Compare, void* Context) {
+    SANITY_CHECK( AssertSaneIntrusiveList(Into) );
+    SANITY_CHECK( AssertSaneIntrusiveList(From) );
+
+    LIST_ORDER Order = { Compare, Context, 0 };
+    MergeSortedLinks(Into, From, &Order);
+}
+
+size_t DedupSortedDataList(LIST* List, LIST_COMPARE_HANDLER Compare,
+                           void* Context) {
+    SANITY_CHECK( AssertSaneDataList(List) );
+
+    LIST_ORDER Order = { Compare, Context, PAYLOAD_OFFSET };
+    return DedupSortedLinks(List, &Order, ReleaseDataLink);
+}
+
+size_t DedupSortedMemoryList(LIST* List, LIST_COMPARE_HANDLER Compare,
+                             void* Context) {
+    SANITY_CHECK( AssertSaneMemoryList(List) );
+
+    LIST_ORDER Order = { Compare, Context, PAYLOAD_OFFSET };
+    return DedupSortedLinks(List, &Order, ReleaseMemoryLink);
+}
+
+size_t DedupSortedIntrusiveList(LIST* List, LIST_COMPARE_HANDLER Compare,
+                                void* Context) {
+    SANITY_CHECK( AssertSaneIntrusiveList(List) );
+
+    LIST_ORDER Order = { Compare, Context, 0 };
+    return DedupSortedLinks(List, &Order, NULL);
+}
@@ -0,0 +1,412 @@
+#include <pthread.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "Log.h"
+
+#define LOG_RING_MASK (LOG_RING_SIZE - 1)
+
+_Static_assert((LOG_RING_SIZE & LOG_RING_MASK) == 0, "LOG_RING_SIZE must be a power of 2");
+
+TYPE_STRUCT(LOG_ENTRY) {
+    uint64_t     Time;
+    const char*  Format;
+    uint8_t      Level;
+    uint8_t      ArgumentAmmount;
+    uint8_t      Types[LOG_MAX_ARGUMENTS];
+    // Strings are stored as their' offset into Strings
+    uint64_t     Arguments[LOG_MAX_ARGUMENTS];
+    char         Strings[LOG_STRING_SPACE];
+};
+
+/* Single producer (the owning thread), single consumer (whoever holds
+ *  DrainLock) ring
+ */
+TYPE_STRUCT(LOG_RING) {
+    LOG_RING*    Next;
+    // TRUE while a thread logs into this ring. Rings of finished threads are
+    //  reused by new ones
+    BOOLEAN      Owned;
+    size_t       Head;
+    size_t       Tail;
+    // Last entry the current drain writes (consumer only)
+    size_t       DrainLimit;
+    LOG_ENTRY    Entries[LOG_RING_SIZE];
+};
+
+static LOG_RING*        RingList        = NULL;
+static __thread LOG_RING* ThreadRing    = NULL;
+static pthread_once_t   LogOnce         = PTHREAD_ONCE_INIT;
+static pthread_key_t    RingOwnerKey;
+static pthread_mutex_t  DrainLock       = PTHREAD_MUTEX_INITIALIZER;
+static FILE*            LogOutput       = NULL;
+static uint64_t         DroppedRecords  = 0;
+
+static pthread_mutex_t  DrainerLock     = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   DrainerStop     = PTHREAD_COND_INITIALIZER;
+static pthread_t        Drainer;
+static BOOLEAN          DrainerRunning  = FALSE;
+static uint32_t         DrainerInterval = 0;
+
+static const char* LevelNames[] = {
+    [LOG_LEVEL_DEBUG]   = "debug",
+    [LOG_LEVEL_INFO]    = "info",
+    [LOG_LEVEL_WARNING] = "warning",
+    [LOG_LEVEL_ERROR]   = "error",
+};
+
+static LOG_RING* AcquireRing(void);
+
+static void DrainRings(void);
+
+static void WriteEntry(const LOG_ENTRY* Entry);
+
+static void WriteConversion(const LOG_ENTRY* Entry, char* Specification,
+                            size_t SpecificationSize, char Conversion,
+                            size_t ArgumentInd);
+
+void LogRecord(int Level, const char* Format, size_t ArgumentAmmount,
+               const LOG_ARGUMENT* Arguments) {
+    LOG_RING* Ring = ThreadRing;
+    struct timespec Now;
+
+    SANITY_CHECK( Assert(ArgumentAmmount <= LOG_MAX_ARGUMENTS) );
+
+    if (Ring == NULL) {
+        Ring = AcquireRing();
+    }
+
+    size_t Tail = __atomic_load_n(&Ring->Tail, __ATOMIC_RELAXED);
+    if (Tail - __atomic_load_n(&Ring->Head, __ATOMIC_ACQUIRE) == LOG_RING_SIZE) {
+        __atomic_fetch_add(&DroppedRecords, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    LOG_ENTRY* Entry = &(Ring->Entries[Tail & LOG_RING_MASK]);
+    size_t StringsUsed = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    Entry->Time            = (uint64_t)Now.tv_sec * 1000000000 + (uint64_t)Now.tv_nsec;
+    Entry->Format          = Format;
+    Entry->Level           = (uint8_t)Level;
+    Entry->ArgumentAmmount = (uint8_t)ArgumentAmmount;
+
+    for (size_t ArgumentInd = 0; ArgumentInd != ArgumentAmmount; ArgumentInd++) {
+        const LOG_ARGUMENT* Argument = &Arguments[ArgumentInd];
+
+        Entry->Types[ArgumentInd] = (uint8_t)Argument->Type;
+        switch (Argument->Type) {
+            case LogString: {
+                // Strings may be gone by the time the entry is formatted
+                const char* String = (Argument->String != NULL) ? Argument->String : "(null)";
+                size_t Length = Strlen(String);
+
+                if (Length > LOG_STRING_SPACE - StringsUsed - 1) {
+                    Length = LOG_STRING_SPACE - StringsUsed - 1;
+                }
+                Memcpy(Entry->Strings + StringsUsed, String, Length);
+                Entry->Strings[StringsUsed + Length] = '\0';
+                Entry->Arguments[ArgumentInd] = StringsUsed;
+                // Strings past the available space become empty
+                if (StringsUsed + Length + 1 < LOG_STRING_SPACE) {
+                    StringsUsed += Length + 1;
+                }
+                break;
+            }
+            case LogReal:
+                Memcpy(&(Entry->Arguments[ArgumentInd]), &(Argument->Real), sizeof(double));
+                break;
+            case LogPointer:
+                Entry->Arguments[ArgumentInd] = (uintptr_t)Argument->Pointer;
+                break;
+            default:
+                Entry->Arguments[ArgumentInd] = Argument->Unsigned;
+                break;
+        }
+    }
+
+    __atomic_store_n(&Ring->Tail, Tail + 1, __ATOMIC_RELEASE);
+
+    if (Level >= LOG_LEVEL_ERROR) {
+        FlushLog();
+    }
+}
+
+void FlushLog(void) {
+    pthread_mutex_lock(&DrainLock);
+    DrainRings();
+    pthread_mutex_unlock(&DrainLock);
+}
+
+void SetLogOutput(FILE* Output) {
+    pthread_mutex_lock(&DrainLock);
+    LogOutput = Output;
+    pthread_mutex_unlock(&DrainLock);
+}
+
+uint64_t GetDroppedLogRecords(void) {
+    return __atomic_load_n(&DroppedRecords, __ATOMIC_RELAXED);
+}
+
+static void* LogDrainer(void* Unused) {
+    (void)Unused;
+    struct timespec Deadline;
+
+    pthread_mutex_lock(&DrainerLock);
+    while (DrainerRunning == TRUE) {
+        clock_gettime(CLOCK_REALTIME, &Deadline);
+        Deadline.tv_sec  += DrainerInterval / 1000;
+        Deadline.tv_nsec += (long)(DrainerInterval % 1000) * 1000000;
+        if (Deadline.tv_nsec >= 1000000000) {
+            Deadline.tv_sec++;
+            Deadline.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&DrainerStop, &DrainerLock, &Deadline);
+
+        pthread_mutex_unlock(&DrainerLock);
+        FlushLog();
+        pthread_mutex_lock(&DrainerLock);
+    }
+    pthread_mutex_unlock(&DrainerLock);
+
+    return NULL;
+}
+
+void StartLogDrainer(uint32_t IntervalMilliseconds) {
+    pthread_mutex_lock(&DrainerLock);
+    if (DrainerRunning == FALSE) {
+        DrainerInterval = IntervalMilliseconds;
+        DrainerRunning  = TRUE;
+        if (pthread_create(&Drainer, NULL, LogDrainer, NULL) != 0) {
+            DrainerRunning = FALSE;
+        }
+    }
+    pthread_mutex_unlock(&DrainerLock);
+}
+
+void StopLogDrainer(void) {
+    pthread_mutex_lock(&DrainerLock);
+    if (DrainerRunning == FALSE) {
+        pthread_mutex_unlock(&DrainerLock);
+        return;
+    }
+    DrainerRunning = FALSE;
+    pthread_cond_signal(&DrainerStop);
+    pthread_mutex_unlock(&DrainerLock);
+
+    pthread_join(Drainer, NULL);
+    FlushLog();
+}
+
+/* Let other threads reuse the ring of a finished thread */
+static void ReleaseRing(void* _Ring) {
+    LOG_RING* Ring = _Ring;
+    __atomic_store_n(&Ring->Owned, FALSE, __ATOMIC_RELEASE);
+}
+
+/* Nothing queued before a fork is written twice, and the child can flush.
+ * DrainerLock is held too so the child can start its' own drainer. It is
+ *  never held together with DrainLock elsewhere, so the order can't deadlock
+ */
+static void PrepareLogFork(void) {
+    pthread_mutex_lock(&DrainerLock);
+    pthread_mutex_lock(&DrainLock);
+    DrainRings();
+}
+
+static void ResumeLogAfterFork(void) {
+    pthread_mutex_unlock(&DrainLock);
+    pthread_mutex_unlock(&DrainerLock);
+}
+
+static void ResumeLogInChild(void) {
+    pthread_mutex_unlock(&DrainLock);
+    // Threads don't survive a fork, nor do their' waits on DrainerStop
+    DrainerRunning = FALSE;
+    pthread_cond_init(&DrainerStop, NULL);
+    pthread_mutex_unlock(&DrainerLock);
+}
+
+static void SetupLog(void) {
+    pthread_key_create(&RingOwnerKey, ReleaseRing);
+    pthread_atfork(PrepareLogFork, ResumeLogAfterFork, ResumeLogInChild);
+    atexit(FlushLog);
+}
+
+static LOG_RING* AcquireRing(void) {
+    LOG_RING* Ring;
+
+    pthread_once(&LogOnce, SetupLog);
+
+    // Reuse a ring from a finished thread
+    for (Ring = __atomic_load_n(&RingList, __ATOMIC_ACQUIRE); Ring != NULL; Ring = Ring->Next) {
+        BOOLEAN Unowned = FALSE;
+        if (__atomic_compare_exchange_n(&Ring->Owned, &Unowned, TRUE, FALSE,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    if (Ring == NULL) {
+        Ring = Malloc(sizeof(LOG_RING));
+        Ring->Owned = TRUE;
+        Ring->Head  = 0;
+        Ring->Tail  = 0;
+        Ring->DrainLimit = 0;
+        Ring->Next  = __atomic_load_n(&RingList, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&RingList, &Ring->Next, Ring, TRUE,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+
+    pthread_setspecific(RingOwnerKey, Ring);
+    ThreadRing = Ring;
+    return Ring;
+}
+
+/* Write every queued entry, merging the rings by time. DrainLock must be held */
+static void DrainRings(void) {
+    LOG_RING* RingHead = __atomic_load_n(&RingList, __ATOMIC_ACQUIRE);
+
+    if (LogOutput == NULL) {
+        LogOutput = stdout;
+    }
+
+    // Only entries queued up to now are written
+    for (LOG_RING* Ring = RingHead; Ring != NULL; Ring = Ring->Next) {
+        Ring->DrainLimit = __atomic_load_n(&Ring->Tail, __ATOMIC_ACQUIRE);
+    }
+
+    while (TRUE) {
+        LOG_RING* Oldest = NULL;
+        const LOG_ENTRY* OldestEntry = NULL;
+
+        for (LOG_RING* Ring = RingHead; Ring != NULL; Ring = Ring->Next) {
+            size_t Head = __atomic_load_n(&Ring->Head, __ATOMIC_RELAXED);
+            if (Head == Ring->DrainLimit) {
+                continue;
+            }
+            const LOG_ENTRY* Entry = &(Ring->Entries[Head & LOG_RING_MASK]);
+            if (Oldest == NULL || Entry->Time < OldestEntry->Time) {
+                Oldest = Ring;
+                OldestEntry = Entry;
+            }
+        }
+
+        if (Oldest == NULL) {
+            break;
+        }
+
+        WriteEntry(OldestEntry);
+        __atomic_store_n(&Oldest->Head, Oldest->Head + 1, __ATOMIC_RELEASE);
+    }
+
+    fflush(LogOutput);
+}
+
+/* Format an entry, one conversion specification at a time */
+static void WriteEntry(const LOG_ENTRY* Entry) {
+    const char* Format = Entry->Format;
+    size_t ArgumentInd = 0;
+
+    fprintf(LogOutput, "[%s] ", LevelNames[Entry->Level]);
+
+    while (*Format != '\0') {
+        const char* Literal = Format;
+        while (*Format != '\0' && *Format != '%') {
+            Format++;
+        }
+        fwrite(Literal, 1, (size_t)(Format - Literal), LogOutput);
+
+        if (*Format == '\0') {
+            break;
+        }
+
+        // Keep flags, width and precision. Length modifiers are replaced
+        //  according to the argument type
+        char Specification[32] = "%";
+        size_t SpecificationSize = 1;
+        Format++;
+        while (*Format != '\0' && strchr("-+ #0123456789.", *Format) != NULL &&
+               SpecificationSize < sizeof(Specification) - 4) {
+            Specification[SpecificationSize++] = *Format++;
+        }
+        while (*Format != '\0' && strchr("hlLqjzt", *Format) != NULL) {
+            Format++;
+        }
+        if (*Format == '\0') {
+            break;
+        }
+
+        char Conversion = *Format++;
+        if (Conversion == '%') {
+            fputc('%', LogOutput);
+            continue;
+        }
+        if (ArgumentInd == Entry->ArgumentAmmount) {
+            fputs("(?)", LogOutput);
+            continue;
+        }
+        WriteConversion(Entry, Specification, SpecificationSize, Conversion, ArgumentInd++);
+    }
+
+    fputc('\n', LogOutput);
+}
+
+static void WriteConversion(const LOG_ENTRY* Entry, char* Specification,
+                            size_t SpecificationSize, char Conversion,
+                            size_t ArgumentInd) {
+    uint64_t Argument = Entry->Arguments[ArgumentInd];
+    LOG_ARGUMENT_TYPE Type = Entry->Types[ArgumentInd];
+    double Real;
+
+    Memcpy(&Real, &Argument, sizeof(double));
+
+    switch (Conversion) {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+            if (Conversion != 'c') {
+                Specification[SpecificationSize++] = 'l';
+                Specification[SpecificationSize++] = 'l';
+            }
+            Specification[SpecificationSize++] = Conversion;
+            Specification[SpecificationSize]   = '\0';
+            if (Type == LogReal) {
+                Argument = (uint64_t)(int64_t)Real;
+            }
+            if (Conversion == 'c') {
+                fprintf(LogOutput, Specification, (int)Argument);
+            } else if (Conversion == 'd' || Conversion == 'i') {
+                fprintf(LogOutput, Specification, (long long)Argument);
+            } else {
+                fprintf(LogOutput, Specification, (unsigned long long)Argument);
+            }
+            break;
+
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            Specification[SpecificationSize++] = Conversion;
+            Specification[SpecificationSize]   = '\0';
+            if (Type == LogSigned) {
+                Real = (double)(int64_t)Argument;
+            } else if (Type == LogUnsigned) {
+                Real = (double)Argument;
+            }
+            fprintf(LogOutput, Specification, Real);
+            break;
+
+        case 's':
+            Specification[SpecificationSize++] = 's';
+            Specification[SpecificationSize]   = '\0';
+            fprintf(LogOutput, Specification,
+                    (Type == LogString) ? Entry->Strings + Argument : "(?)");
+            break;
+
+        case 'p':
+            Specification[SpecificationSize++] = 'p';
+            Specification[SpecificationSize]   = '\0';
+            fprintf(LogOutput, Specification, (void*)(uintptr_t)Argument);
+            break;
+
+        default:
+            fputs("(?)", LogOutput);
+            break;
+    }
+}
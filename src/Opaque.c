@@ -1,10 +1,31 @@
+#include <stdatomic.h>
+
 #include "Opaque.h"
+#include "Probes.h"
+#include "Log.h"
+
+/* Header preceeding the memory of Shared OPAQUE_MEMORY */
+typedef struct {
+    atomic_size_t References;
+    _Alignas(max_align_t) uint8_t Data[];
+}OPAQUE_SHARED_BLOCK;
+
+#define SHARED_BLOCK_OF(Opaque) \
+CONTAINER_OF((Opaque)->Data, OPAQUE_SHARED_BLOCK, Data)
 
 #ifdef ENABLE_SANITY_CHECKS
 
 void AssertSaneOpaqueMemory(OPAQUE_MEMORY* Opaque) {
     Assert(Opaque != NULL);
-    if (Opaque->Allocated == TRUE) {
+    if (Opaque->Inline == TRUE) {
+        Assert(Opaque->Allocated == FALSE);
+        Assert(Opaque->Shared == FALSE);
+        Assert(Opaque->Size <= OPAQUE_INLINE_SIZE);
+    } else if (Opaque->Shared == TRUE) {
+        Assert(Opaque->Allocated == FALSE);
+        Assert(Opaque->Data != NULL);
+        Assert(atomic_load(&(SHARED_BLOCK_OF(Opaque)->References)) > 0);
+    } else if (Opaque->Allocated == TRUE) {
         Assert(Opaque->Data != NULL);
         Assert(Opaque->Size > 0);
     }
@@ -15,12 +36,24 @@ void AssertSaneOpaqueMemory(OPAQUE_MEMORY* Opaque) {
 void SetupOpaqueMemory(OPAQUE_MEMORY* Opaque, size_t Size) {
     SANITY_CHECK( Assert(Opaque != NULL) );
 
-    Opaque->Size = Size;
+    Opaque->Size   = Size;
+    Opaque->Shared = FALSE;
+
+    if (Size <= OPAQUE_INLINE_SIZE) {
+        Opaque->Allocated = FALSE;
+        Opaque->Inline    = TRUE;
+        return;
+    }
+
+    Opaque->Inline = FALSE;
     Opaque->Data = Malloc(Opaque->Size);
 
     SANITY_CHECK( Assert(Opaque->Data != NULL) );
 
     if (Opaque->Data != NULL) {
+        PROBE(opaque_allocate, Opaque, Size);
+        COUNT(OpaqueAllocations, 1);
+        COUNT(BytesAllocated, Size);
         Opaque->Allocated = TRUE;
         return;
     }
@@ -29,23 +62,84 @@ void SetupOpaqueMemory(OPAQUE_MEMORY* Opaque, size_t Size) {
     Opaque->Allocated = TRUE;
 }
 
+void SetupSharedOpaqueMemory(OPAQUE_MEMORY* Opaque, size_t Size) {
+    SANITY_CHECK( Assert(Opaque != NULL) );
+
+    OPAQUE_SHARED_BLOCK* Block = Malloc(sizeof(OPAQUE_SHARED_BLOCK) + Size);
+
+    SANITY_CHECK( Assert(Block != NULL) );
+
+    PROBE(opaque_allocate, Opaque, Size);
+    COUNT(OpaqueAllocations, 1);
+    COUNT(BytesAllocated, Size);
+
+    atomic_init(&(Block->References), 1);
+    Opaque->Size      = Size;
+    Opaque->Allocated = FALSE;
+    Opaque->Inline    = FALSE;
+    Opaque->Shared    = TRUE;
+    Opaque->Data      = Block->Data;
+}
+
+OPAQUE_MEMORY ShareOpaqueMemory(OPAQUE_MEMORY* Opaque) {
+    SANITY_CHECK( AssertSaneOpaqueMemory(Opaque) );
+
+    if (Opaque->Inline == TRUE) {
+        return *Opaque;
+    }
+
+    if (Opaque->Shared == FALSE) {
+        OPAQUE_MEMORY SharedMemory;
+        SetupSharedOpaqueMemory(&SharedMemory, Opaque->Size);
+        if (Opaque->Size != 0) {
+            Memcpy(SharedMemory.Data, Opaque->Data, Opaque->Size);
+            COUNT(BytesCopied, Opaque->Size);
+        }
+        ClearOpaqueMemory(Opaque);
+        *Opaque = SharedMemory;
+    }
+
+    atomic_fetch_add_explicit(&(SHARED_BLOCK_OF(Opaque)->References), 1,
+                              memory_order_relaxed);
+    return *Opaque;
+}
+
+void* GetWritableOpaqueMemory(OPAQUE_MEMORY* Opaque) {
+    SANITY_CHECK( AssertSaneOpaqueMemory(Opaque) );
+
+    if (Opaque->Shared == TRUE &&
+        atomic_load_explicit(&(SHARED_BLOCK_OF(Opaque)->References),
+                             memory_order_acquire) != 1) {
+        OPAQUE_MEMORY Private;
+        SetupOpaqueMemory(&Private, Opaque->Size);
+        if (Opaque->Size != 0) {
+            Memcpy(OPAQUE_MEMORY_DATA(&Private), Opaque->Data, Opaque->Size);
+            COUNT(BytesCopied, Opaque->Size);
+        }
+        ClearOpaqueMemory(Opaque);
+        *Opaque = Private;
+    }
+
+    return OPAQUE_MEMORY_DATA(Opaque);
+}
+
 void CopyRawMemory_4(OPAQUE_MEMORY* Destination, const void* Base, int Offset,
                      size_t Size) {
     SANITY_CHECK( AssertSaneOpaqueMemory(Destination) );
-    SANITY_CHECK( Assert(Base != NULL) );
+    SANITY_CHECK( Assert(Base != NULL || Size == 0) );
 
     // We cant resize Destination and copy into it because we run the risc of
     // undefined behavior in case `Base` is the address stored in Destination
     // (i.e. Copy/Append(X, X))
 
-    uint8_t*    NewMemory;
-    uint8_t*    NewMemoryIndex;
-    size_t      FirstSliceSize;
-    size_t      NewSize;
+    OPAQUE_MEMORY   NewMemory;
+    uint8_t*        NewMemoryIndex;
+    size_t          FirstSliceSize;
+    size_t          NewSize;
 
     // Offset Destination backwards
     if (Offset < 0) {
-        SANITY_CHECK( Assert((size_t)(-1 * Offset) >= Destination->Size) );
+        SANITY_CHECK( Assert((size_t)(-1 * Offset) <= Destination->Size) );
 
         NewSize         = Destination->Size + Offset + Size;
         FirstSliceSize  = Destination->Size + Offset;
@@ -54,19 +148,22 @@ void CopyRawMemory_4(OPAQUE_MEMORY* Destination, const void* Base, int Offset,
         FirstSliceSize  = Offset;
     }
 
-    NewMemory = (uint8_t*)Malloc(NewSize);
-    NewMemoryIndex = NewMemory;
+    SetupOpaqueMemory(&NewMemory, NewSize);
+    NewMemoryIndex = OPAQUE_MEMORY_DATA(&NewMemory);
 
-    Memcpy(NewMemoryIndex, Destination->Data, FirstSliceSize);
+    if (FirstSliceSize != 0) {
+        Memcpy(NewMemoryIndex, OPAQUE_MEMORY_DATA(Destination), FirstSliceSize);
+    }
     NewMemoryIndex += FirstSliceSize;
-    Memcpy(NewMemoryIndex, Base, Size);
+    if (Size != 0) {
+        Memcpy(NewMemoryIndex, Base, Size);
+    }
+    COUNT(BytesCopied, FirstSliceSize + Size);
 
-    SANITY_CHECK( Assert((size_t)(NewMemoryIndex - NewMemory) + Size == NewSize) );
+    SANITY_CHECK( Assert((size_t)(NewMemoryIndex - (uint8_t*)OPAQUE_MEMORY_DATA(&NewMemory)) + Size == NewSize) );
 
     ClearOpaqueMemory(Destination);
-    Destination->Data = NewMemory;
-    Destination->Allocated = TRUE;
-    Destination->Size = NewSize;
+    *Destination = NewMemory;
 }
 
 void CopyRawMemory_3(OPAQUE_MEMORY* Destination, const void* Base, size_t Size) {
@@ -82,7 +179,16 @@ void CopyOpaqueMemory_4(OPAQUE_MEMORY* Destination, OPAQUE_MEMORY* Source, \
     SANITY_CHECK( AssertSaneOpaqueMemory(Source) );
     SANITY_CHECK( Assert(Ammount <= Source->Size) );
 
-    CopyRawMemory_4(Destination, Source->Data, Offset, Ammount);
+    // Replacing Destination with all of a shared Source is just a reference
+    if (Source->Shared == TRUE && Offset == 0 && Ammount == Source->Size &&
+        Destination != Source) {
+        OPAQUE_MEMORY Reference = ShareOpaqueMemory(Source);
+        ClearOpaqueMemory(Destination);
+        *Destination = Reference;
+        return;
+    }
+
+    CopyRawMemory_4(Destination, OPAQUE_MEMORY_DATA(Source), Offset, Ammount);
 }
 
 void CopyOpaqueMemory_3(OPAQUE_MEMORY* Destination, OPAQUE_MEMORY* Source, \
@@ -104,13 +210,26 @@ void AppendOpaqueMemory_3(OPAQUE_MEMORY* Destination, OPAQUE_MEMORY* Source, \
 }
 
 OPAQUE_MEMORY DuplicateIntoOpaqueMemory_2(const void* Base, size_t Size) {
-    SANITY_CHECK( Assert(Base != NULL) );
+    SANITY_CHECK( Assert(Base != NULL || Size == 0) );
 
     OPAQUE_MEMORY Opaque;
-    Opaque.Size = Size;
-    Opaque.Data = DuplicateGenericMemory(Base, Size);
+    COUNT(BytesCopied, Size);
+
+    if (Size <= OPAQUE_INLINE_SIZE) {
+        SetupOpaqueMemory(&Opaque, Size);
+        Memcpy(Opaque.InlineData, Base, Size);
+        return Opaque;
+    }
+
+    Opaque.Size   = Size;
+    Opaque.Inline = FALSE;
+    Opaque.Shared = FALSE;
+    Opaque.Data   = DuplicateGenericMemory(Base, Size);
     if (Opaque.Data != NULL) {
         Opaque.Allocated = TRUE;
+        PROBE(opaque_allocate, &Opaque, Size);
+        COUNT(OpaqueAllocations, 1);
+        COUNT(BytesAllocated, Size);
     } else {
         Opaque.Allocated = FALSE;
     }
@@ -130,9 +249,32 @@ OPAQUE_MEMORY DuplicateIntoOpaqueMemory_2(const void* Base, size_t Size) {
 // }
 
 
+OPAQUE_MEMORY SliceOpaqueMemory(OPAQUE_MEMORY* Source, size_t Offset,
+                                size_t Size) {
+    SANITY_CHECK( AssertSaneOpaqueMemory(Source) );
+    SANITY_CHECK( Assert(Offset <= Source->Size) );
+    SANITY_CHECK( Assert(Size <= Source->Size - Offset) );
+
+    return CLOAK_MEMORY(Size, FALSE, (uint8_t*)OPAQUE_MEMORY_DATA(Source) + Offset);
+}
+
+void SplitOpaqueMemory(OPAQUE_MEMORY* Source, size_t At, OPAQUE_MEMORY* Left,
+                       OPAQUE_MEMORY* Right) {
+    SANITY_CHECK( Assert(At <= Source->Size) );
+
+    // Source may be one of the outputs
+    OPAQUE_MEMORY LeftView  = SliceOpaqueMemory(Source, 0, At);
+    OPAQUE_MEMORY RightView = SliceOpaqueMemory(Source, At, Source->Size - At);
+
+    *Left  = LeftView;
+    *Right = RightView;
+}
+
 OPAQUE_MEMORY* AllocateOpaqueMemory(size_t Size) {
     ALLOC_STRUCT(OPAQUE_MEMORY, Opaque);
     Opaque->Allocated = FALSE;
+    Opaque->Inline    = FALSE;
+    Opaque->Shared    = FALSE;
     SetupOpaqueMemory(Opaque, Size);
     return Opaque;
 }
@@ -140,10 +282,25 @@ OPAQUE_MEMORY* AllocateOpaqueMemory(size_t Size) {
 void ClearOpaqueMemory(OPAQUE_MEMORY* Opaque) {
     SANITY_CHECK( Assert(Opaque != NULL) );
 
-    if (Opaque->Allocated == TRUE) {
+    if (Opaque->Shared == TRUE) {
+        OPAQUE_SHARED_BLOCK* Block = SHARED_BLOCK_OF(Opaque);
+        // The last reference releases the block
+        if (atomic_fetch_sub_explicit(&(Block->References), 1,
+                                      memory_order_acq_rel) == 1) {
+            PROBE(opaque_free, Opaque, Opaque->Size);
+            COUNT(OpaqueFrees, 1);
+            Free(Block);
+        }
+    } else if (Opaque->Allocated == TRUE) {
+        PROBE(opaque_free, Opaque, Opaque->Size);
+        COUNT(OpaqueFrees, 1);
         Free(Opaque->Data);
     }
     Opaque->Allocated = FALSE;
+    Opaque->Inline    = FALSE;
+    Opaque->Shared    = FALSE;
+    Opaque->Data      = NULL;
+    Opaque->Size      = 0;
 }
 
 void ResizeOpaqueMemory(OPAQUE_MEMORY* Memory, size_t NewSize) {
@@ -151,15 +308,17 @@ void ResizeOpaqueMemory(OPAQUE_MEMORY* Memory, size_t NewSize) {
         return;
     }
 
-    printf("%p\n", Memory->Data);
-
-    void* New = Malloc(NewSize);
-    Memcpy(New, Memory->Data, Memory->Size);
-    Free(Memory->Data);
-    Memory->Data = New;
-    Memory->Size = NewSize;
-
-    printf("%p\n", Memory->Data);
+    PROBE(opaque_resize, Memory, Memory->Size, NewSize);
+    COUNT(OpaqueResizes, 1);
+    LOG_DEBUG("Resizing %p from %zu to %zu bytes", (void*)Memory, Memory->Size, NewSize);
+
+    size_t Kept = (Memory->Size < NewSize) ? Memory->Size : NewSize;
+    OPAQUE_MEMORY New;
+    SetupOpaqueMemory(&New, NewSize);
+    Memcpy(OPAQUE_MEMORY_DATA(&New), OPAQUE_MEMORY_DATA(Memory), Kept);
+    COUNT(BytesCopied, Kept);
+    ClearOpaqueMemory(Memory);
+    *Memory = New;
 
     // #ifdef ENABLE_SANITY_CHECKS
     //     void* Ret = Realloc(Memory->Data, Memory->Size);
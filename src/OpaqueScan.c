@@ -0,0 +1,274 @@
+#include "Opaque.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86
+#endif
+
+/* Kernels over raw bytes. Each exists in a portable version and, on x86,
+ *  SSE2 and AVX2 versions picked before main according to the running CPU
+ * Fill has no kernel: libc memset is already vectorized and faster than plain
+ *  vector stores on large buffers
+ */
+
+// Index of the first difference between `A` and `B`, or `Size`
+typedef size_t (*MISMATCH_KERNEL)(const uint8_t* A, const uint8_t* B, size_t Size);
+// Index of the first `Byte`, or `Size`
+typedef size_t (*FIND_BYTE_KERNEL)(const uint8_t* Base, size_t Size, uint8_t Byte);
+// Index of the first `Pattern` occurence (PatternSize >= 2), or `Size`
+typedef size_t (*FIND_PATTERN_KERNEL)(const uint8_t* Base, size_t Size,
+                                      const uint8_t* Pattern, size_t PatternSize);
+typedef size_t (*COUNT_BYTE_KERNEL)(const uint8_t* Base, size_t Size, uint8_t Byte);
+
+//                          Portable kernels
+
+static size_t MismatchPortable(const uint8_t* A, const uint8_t* B, size_t Size) {
+    size_t Ind = 0;
+
+    // Word at a time until a difference shows up
+    for (; Ind + sizeof(uint64_t) <= Size; Ind += sizeof(uint64_t)) {
+        uint64_t WordA, WordB;
+        Memcpy(&WordA, A + Ind, sizeof(WordA));
+        Memcpy(&WordB, B + Ind, sizeof(WordB));
+        if (WordA != WordB) {
+            break;
+        }
+    }
+    for (; Ind != Size; Ind++) {
+        if (A[Ind] != B[Ind]) {
+            return Ind;
+        }
+    }
+    return Size;
+}
+
+static size_t FindBytePortable(const uint8_t* Base, size_t Size, uint8_t Byte) {
+    const uint8_t* Found = memchr(Base, Byte, Size);
+
+    return (Found != NULL) ? (size_t)(Found - Base) : Size;
+}
+
+static size_t FindPatternPortable(const uint8_t* Base, size_t Size,
+                                  const uint8_t* Pattern, size_t PatternSize) {
+    for (size_t Ind = 0; Ind + PatternSize <= Size; Ind++) {
+        Ind += FindBytePortable(Base + Ind, Size - Ind - PatternSize + 1, Pattern[0]);
+        if (Ind + PatternSize > Size) {
+            break;
+        }
+        if (memcmp(Base + Ind + 1, Pattern + 1, PatternSize - 1) == 0) {
+            return Ind;
+        }
+    }
+    return Size;
+}
+
+static size_t CountBytePortable(const uint8_t* Base, size_t Size, uint8_t Byte) {
+    size_t Count = 0;
+
+    for (size_t Ind = 0; Ind != Size; Ind++) {
+        Count += (Base[Ind] == Byte);
+    }
+    return Count;
+}
+
+#ifdef SCAN_X86
+
+/* Generate the SSE2 (16 byte) and AVX2 (32 byte) kernels from the same code
+ *  with the vector type and intrinsics as parameters
+ */
+#define VECTOR_KERNELS(Suffix, Target, Vector, Width, Load, Set1,            \
+                       CompareEqual, And, Or, MoveMask)                      \
+                                                                              \
+__attribute__((target(Target)))                                               \
+static size_t GLUE(Mismatch, Suffix)(const uint8_t* A, const uint8_t* B,      \
+                                     size_t Size) {                           \
+    size_t Ind = 0;                                                           \
+    for (; Ind + Width <= Size; Ind += Width) {                               \
+        uint32_t Equal = (uint32_t)MoveMask(CompareEqual(                     \
+                            Load((const Vector*)(A + Ind)),                   \
+                            Load((const Vector*)(B + Ind))));                 \
+        if (Equal != (uint32_t)((1ULL << Width) - 1)) {                       \
+            return Ind + __builtin_ctz(~Equal);                               \
+        }                                                                     \
+    }                                                                         \
+    return Ind + MismatchPortable(A + Ind, B + Ind, Size - Ind);              \
+}                                                                             \
+                                                                              \
+__attribute__((target(Target)))                                               \
+static size_t GLUE(FindByte, Suffix)(const uint8_t* Base, size_t Size,        \
+                                     uint8_t Byte) {                          \
+    Vector Needle = Set1((char)Byte);                                         \
+    size_t Ind = 0;                                                           \
+    /* Four vectors per iteration, only looked into once something matched */ \
+    for (; Ind + 4 * Width <= Size; Ind += 4 * Width) {                       \
+        const Vector* Block = (const Vector*)(Base + Ind);                    \
+        Vector Match0 = CompareEqual(Load(Block), Needle);                    \
+        Vector Match1 = CompareEqual(Load(Block + 1), Needle);                \
+        Vector Match2 = CompareEqual(Load(Block + 2), Needle);                \
+        Vector Match3 = CompareEqual(Load(Block + 3), Needle);                \
+        if (MoveMask(Or(Or(Match0, Match1), Or(Match2, Match3))) != 0) {      \
+            break;                                                            \
+        }                                                                     \
+    }                                                                         \
+    for (; Ind + Width <= Size; Ind += Width) {                               \
+        uint32_t Found = (uint32_t)MoveMask(CompareEqual(                     \
+                            Load((const Vector*)(Base + Ind)), Needle));      \
+        if (Found != 0) {                                                     \
+            return Ind + __builtin_ctz(Found);                                \
+        }                                                                     \
+    }                                                                         \
+    return Ind + FindBytePortable(Base + Ind, Size - Ind, Byte);              \
+}                                                                             \
+                                                                              \
+/* Candidates must match the first and last pattern bytes, only those are     \
+ *  compared in full                                                          \
+ */                                                                           \
+__attribute__((target(Target)))                                               \
+static size_t GLUE(FindPattern, Suffix)(const uint8_t* Base, size_t Size,     \
+                                        const uint8_t* Pattern,               \
+                                        size_t PatternSize) {                 \
+    Vector First = Set1((char)Pattern[0]);                                    \
+    Vector Last  = Set1((char)Pattern[PatternSize - 1]);                      \
+    size_t Ind = 0;                                                           \
+    for (; Ind + PatternSize - 1 + Width <= Size; Ind += Width) {             \
+        uint32_t Candidates = (uint32_t)MoveMask(And(                         \
+            CompareEqual(Load((const Vector*)(Base + Ind)), First),           \
+            CompareEqual(Load((const Vector*)(Base + Ind + PatternSize - 1)), \
+                         Last)));                                             \
+        while (Candidates != 0) {                                             \
+            size_t Candidate = Ind + __builtin_ctz(Candidates);               \
+            if (memcmp(Base + Candidate + 1, Pattern + 1,                     \
+                       PatternSize - 2) == 0) {                               \
+                return Candidate;                                             \
+            }                                                                 \
+            Candidates &= Candidates - 1;                                     \
+        }                                                                     \
+    }                                                                         \
+    return Ind + FindPatternPortable(Base + Ind, Size - Ind, Pattern,         \
+                                     PatternSize);                            \
+}                                                                             \
+                                                                              \
+__attribute__((target(Target)))                                               \
+static size_t GLUE(CountByte, Suffix)(const uint8_t* Base, size_t Size,       \
+                                      uint8_t Byte) {                         \
+    Vector Needle = Set1((char)Byte);                                         \
+    size_t Count = 0;                                                         \
+    size_t Ind = 0;                                                           \
+    for (; Ind + Width <= Size; Ind += Width) {                               \
+        Count += __builtin_popcount((uint32_t)MoveMask(CompareEqual(          \
+                    Load((const Vector*)(Base + Ind)), Needle)));             \
+    }                                                                         \
+    return Count + CountBytePortable(Base + Ind, Size - Ind, Byte);           \
+}
+
+VECTOR_KERNELS(SSE2, "sse2", __m128i, 16, _mm_loadu_si128, _mm_set1_epi8,
+               _mm_cmpeq_epi8, _mm_and_si128, _mm_or_si128, _mm_movemask_epi8)
+
+VECTOR_KERNELS(AVX2, "avx2", __m256i, 32, _mm256_loadu_si256, _mm256_set1_epi8,
+               _mm256_cmpeq_epi8, _mm256_and_si256, _mm256_or_si256,
+               _mm256_movemask_epi8)
+
+#endif /* SCAN_X86 */
+
+// Portable until the CPU is inspected, so constructors can already use them
+static MISMATCH_KERNEL      Mismatch    = MismatchPortable;
+static FIND_BYTE_KERNEL     FindByte    = FindBytePortable;
+static FIND_PATTERN_KERNEL  FindPattern = FindPatternPortable;
+static COUNT_BYTE_KERNEL    CountByte   = CountBytePortable;
+
+static void RUN_BEFORE_MAIN SelectScanKernels(void) {
+    #ifdef SCAN_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        Mismatch    = MismatchAVX2;
+        FindByte    = FindByteAVX2;
+        FindPattern = FindPatternAVX2;
+        CountByte   = CountByteAVX2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        Mismatch    = MismatchSSE2;
+        FindByte    = FindByteSSE2;
+        FindPattern = FindPatternSSE2;
+        CountByte   = CountByteSSE2;
+    }
+    #endif
+}
+
+int CompareOpaqueMemory(OPAQUE_MEMORY* A, OPAQUE_MEMORY* B) {
+    SANITY_CHECK( AssertSaneOpaqueMemory(A) );
+    SANITY_CHECK( AssertSaneOpaqueMemory(B) );
+
+    const uint8_t* DataA = OPAQUE_MEMORY_DATA(A);
+    const uint8_t* DataB = OPAQUE_MEMORY_DATA(B);
+    size_t Common = (A->Size < B->Size) ? A->Size : B->Size;
+    size_t Difference = Mismatch(DataA, DataB, Common);
+
+    if (Difference != Common) {
+        return (DataA[Difference] < DataB[Difference]) ? -1 : 1;
+    }
+    if (A->Size == B->Size) {
+        return 0;
+    }
+    return (A->Size < B->Size) ? -1 : 1;
+}
+
+BOOLEAN OpaqueMemoryEqual(OPAQUE_MEMORY* A, OPAQUE_MEMORY* B) {
+    SANITY_CHECK( AssertSaneOpaqueMemory(A) );
+    SANITY_CHECK( AssertSaneOpaqueMemory(B) );
+
+    if (A->Size != B->Size) {
+        return FALSE;
+    }
+    if (Mismatch(OPAQUE_MEMORY_DATA(A), OPAQUE_MEMORY_DATA(B), A->Size) != A->Size) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+size_t FindByteInOpaqueMemory(OPAQUE_MEMORY* Memory, uint8_t Byte,
+                              size_t Offset) {
+    SANITY_CHECK( AssertSaneOpaqueMemory(Memory) );
+
+    if (Offset >= Memory->Size) {
+        return OPAQUE_NOT_FOUND;
+    }
+
+    const uint8_t* Base = (uint8_t*)OPAQUE_MEMORY_DATA(Memory) + Offset;
+    size_t Found = FindByte(Base, Memory->Size - Offset, Byte);
+
+    return (Found == Memory->Size - Offset) ? OPAQUE_NOT_FOUND : Offset + Found;
+}
+
+size_t FindInOpaqueMemory(OPAQUE_MEMORY* Memory, const void* Pattern,
+                          size_t PatternSize, size_t Offset) {
+    SANITY_CHECK( AssertSaneOpaqueMemory(Memory) );
+    SANITY_CHECK( Assert(Pattern != NULL || PatternSize == 0) );
+
+    if (PatternSize == 0) {
+        return (Offset <= Memory->Size) ? Offset : OPAQUE_NOT_FOUND;
+    }
+    if (PatternSize == 1) {
+        return FindByteInOpaqueMemory(Memory, *(const uint8_t*)Pattern, Offset);
+    }
+    if (Offset >= Memory->Size || Memory->Size - Offset < PatternSize) {
+        return OPAQUE_NOT_FOUND;
+    }
+
+    const uint8_t* Base = (uint8_t*)OPAQUE_MEMORY_DATA(Memory) + Offset;
+    size_t Found = FindPattern(Base, Memory->Size - Offset, Pattern, PatternSize);
+
+    return (Found == Memory->Size - Offset) ? OPAQUE_NOT_FOUND : Offset + Found;
+}
+
+size_t CountByteInOpaqueMemory(OPAQUE_MEMORY* Memory, uint8_t Byte) {
+    SANITY_CHECK( AssertSaneOpaqueMemory(Memory) );
+
+    return CountByte(OPAQUE_MEMORY_DATA(Memory), Memory->Size, Byte);
+}
+
+void FillOpaqueMemory(OPAQUE_MEMORY* Memory, uint8_t Byte) {
+    SANITY_CHECK( AssertSaneOpaqueMemory(Memory) );
+
+    // libc memset already dispatches to the best vector stores for the CPU
+    memset(GetWritableOpaqueMemory(Memory), Byte, Memory->Size);
+}
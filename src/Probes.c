@@ -0,0 +1,137 @@
+#include <pthread.h>
+
+#include "Probes.h"
+
+#define COUNTER_AMMOUNT (sizeof(RUNTIME_COUNTERS) / sizeof(uint64_t))
+
+/* Counters of one thread. When a thread exits its' counts are folded into
+ *  DetachedCounters and the block is reused by another thread
+ */
+typedef struct __attribute__((aligned(64))) COUNTER_BLOCK {
+    RUNTIME_COUNTERS        Counters;
+    struct COUNTER_BLOCK*   Next;
+    BOOLEAN                 Owned;
+}COUNTER_BLOCK;
+
+__thread RUNTIME_COUNTERS* ThreadCounters = NULL;
+// Set once the thread gave its' block back (e.g. for counts from later TLS
+//  destructors), it then counts into DetachedCounters
+static __thread BOOLEAN ThreadDetached = FALSE;
+
+// Counts of finished threads and detached ones, updated atomically
+static RUNTIME_COUNTERS DetachedCounters;
+
+static pthread_once_t   CountersOnce    = PTHREAD_ONCE_INIT;
+static pthread_key_t    BlockOwnerKey;
+static COUNTER_BLOCK*   BlockList       = NULL;
+
+static void AddCounters(RUNTIME_COUNTERS* Destination, RUNTIME_COUNTERS* Source) {
+    uint64_t* DestinationArray = (uint64_t*)Destination;
+    uint64_t* SourceArray = (uint64_t*)Source;
+
+    for (size_t CounterInd = 0; CounterInd != COUNTER_AMMOUNT; CounterInd++) {
+        __atomic_fetch_add(&DestinationArray[CounterInd],
+                           __atomic_load_n(&SourceArray[CounterInd], __ATOMIC_RELAXED),
+                           __ATOMIC_RELAXED);
+    }
+}
+
+static void ClearCounters(RUNTIME_COUNTERS* Counters) {
+    uint64_t* CounterArray = (uint64_t*)Counters;
+
+    for (size_t CounterInd = 0; CounterInd != COUNTER_AMMOUNT; CounterInd++) {
+        __atomic_store_n(&CounterArray[CounterInd], 0, __ATOMIC_RELAXED);
+    }
+}
+
+/* Fold the counts of a finished thread into DetachedCounters and let other
+ *  threads reuse its' block
+ */
+static void ReleaseBlock(void* _Block) {
+    COUNTER_BLOCK* Block = _Block;
+
+    ThreadCounters = NULL;
+    ThreadDetached = TRUE;
+
+    AddCounters(&DetachedCounters, &Block->Counters);
+    ClearCounters(&Block->Counters);
+    __atomic_store_n(&Block->Owned, FALSE, __ATOMIC_RELEASE);
+}
+
+/* Threads don't survive a fork, only the forking one keeps its' block */
+static void ReleaseBlocksInChild(void) {
+    for (COUNTER_BLOCK* Block = BlockList; Block != NULL; Block = Block->Next) {
+        if (&Block->Counters != ThreadCounters) {
+            Block->Owned = FALSE;
+        }
+    }
+}
+
+static void SetupCounters(void) {
+    pthread_key_create(&BlockOwnerKey, ReleaseBlock);
+    pthread_atfork(NULL, NULL, ReleaseBlocksInChild);
+}
+
+static RUNTIME_COUNTERS* AcquireThreadCounters(void) {
+    COUNTER_BLOCK* Block;
+
+    pthread_once(&CountersOnce, SetupCounters);
+
+    for (Block = __atomic_load_n(&BlockList, __ATOMIC_ACQUIRE); Block != NULL; Block = Block->Next) {
+        BOOLEAN Unowned = FALSE;
+        if (__atomic_compare_exchange_n(&Block->Owned, &Unowned, TRUE, FALSE,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    if (Block == NULL) {
+        Block = aligned_alloc(_Alignof(COUNTER_BLOCK), sizeof(COUNTER_BLOCK));
+        SANITY_CHECK( Assert(Block != NULL) );
+        memset(&Block->Counters, 0, sizeof(Block->Counters));
+        Block->Owned = TRUE;
+        Block->Next  = __atomic_load_n(&BlockList, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&BlockList, &Block->Next, Block, TRUE,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+
+    pthread_setspecific(BlockOwnerKey, Block);
+    ThreadCounters = &Block->Counters;
+    return ThreadCounters;
+}
+
+void CountWithoutBlock(size_t Offset, uint64_t Value) {
+    if (ThreadDetached == TRUE) {
+        __atomic_fetch_add((uint64_t*)((uint8_t*)&DetachedCounters + Offset), Value,
+                           __ATOMIC_RELAXED);
+        return;
+    }
+
+    RUNTIME_COUNTERS* Counters = AcquireThreadCounters();
+    uint64_t* Counter = (uint64_t*)((uint8_t*)Counters + Offset);
+    __atomic_store_n(Counter, __atomic_load_n(Counter, __ATOMIC_RELAXED) + Value,
+                     __ATOMIC_RELAXED);
+}
+
+void GetRuntimeCounters(RUNTIME_COUNTERS* Counters) {
+    SANITY_CHECK( Assert(Counters != NULL) );
+
+    memset(Counters, 0, sizeof(*Counters));
+    AddCounters(Counters, &DetachedCounters);
+
+    for (COUNTER_BLOCK* Block = __atomic_load_n(&BlockList, __ATOMIC_ACQUIRE);
+         Block != NULL;
+         Block = Block->Next) {
+        AddCounters(Counters, &Block->Counters);
+    }
+}
+
+void ResetRuntimeCounters(void) {
+    ClearCounters(&DetachedCounters);
+
+    for (COUNTER_BLOCK* Block = __atomic_load_n(&BlockList, __ATOMIC_ACQUIRE);
+         Block != NULL;
+         Block = Block->Next) {
+        ClearCounters(&Block->Counters);
+    }
+}
@@ -0,0 +1,217 @@
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Zygote.h"
+
+// Requests are a single byte
+#define ZYGOTE_SPAWN 'S'
+#define ZYGOTE_STOP  'Q'
+
+static BOOLEAN SetSocketTimeout(int Socket, unsigned Milliseconds);
+
+static BOOLEAN SetupZygoteAddress(const char* SocketPath, struct sockaddr_un* Address);
+
+static int ConnectToZygote(const char* SocketPath);
+
+static BOOLEAN SendAll(int Socket, const void* Data, size_t Size);
+
+static BOOLEAN ReceiveAll(int Socket, void* Data, size_t Size);
+
+BOOLEAN RunInitializationZygote(const char* SocketPath) {
+    struct sockaddr_un Address;
+    struct sigaction IgnoreChildren = { .sa_handler = SIG_IGN };
+    struct sigaction PreviousChildAction;
+    int Listener;
+
+    RunForkSafeInitializationFunctions();
+
+    if (SetupZygoteAddress(SocketPath, &Address) == FALSE) {
+        ReleaseInitializationFunctions();
+        return FALSE;
+    }
+
+    Listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    unlink(SocketPath);
+    if (Listener == -1 ||
+        bind(Listener, (struct sockaddr*)&Address, sizeof(Address)) != 0 ||
+        listen(Listener, SOMAXCONN) != 0) {
+        if (Listener != -1) {
+            close(Listener);
+        }
+        ReleaseInitializationFunctions();
+        return FALSE;
+    }
+
+    // Workers are reaped automatically
+    sigaction(SIGCHLD, &IgnoreChildren, &PreviousChildAction);
+
+    while (TRUE) {
+        char Request;
+        int Connection = accept(Listener, NULL, NULL);
+
+        if (Connection == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+
+        // A peer that connects and sends nothing must not block later requests
+        if (SetSocketTimeout(Connection, ZYGOTE_REQUEST_TIMEOUT_MS) == FALSE ||
+            ReceiveAll(Connection, &Request, sizeof(Request)) == FALSE) {
+            close(Connection);
+            continue;
+        }
+
+        if (Request == ZYGOTE_STOP) {
+            SendAll(Connection, &Request, sizeof(Request));
+            close(Connection);
+            break;
+        }
+
+        if (Request != ZYGOTE_SPAWN) {
+            close(Connection);
+            continue;
+        }
+
+        // Don't let workers flush the zygotes' buffered output again
+        fflush(NULL);
+        pid_t Worker = fork();
+        if (Worker == 0) {
+            close(Listener);
+            close(Connection);
+            sigaction(SIGCHLD, &PreviousChildAction, NULL);
+
+            RunPostForkInitializationFunctions();
+            return TRUE;
+        }
+
+        SendAll(Connection, &Worker, sizeof(Worker));
+        close(Connection);
+    }
+
+    close(Listener);
+    unlink(SocketPath);
+    sigaction(SIGCHLD, &PreviousChildAction, NULL);
+
+    ReleaseInitializationFunctions();
+    return FALSE;
+}
+
+pid_t SpawnFromZygote(const char* SocketPath) {
+    char Request = ZYGOTE_SPAWN;
+    pid_t Worker = -1;
+    int Connection = ConnectToZygote(SocketPath);
+
+    if (Connection == -1) {
+        return -1;
+    }
+
+    if (SendAll(Connection, &Request, sizeof(Request)) == FALSE ||
+        ReceiveAll(Connection, &Worker, sizeof(Worker)) == FALSE) {
+        Worker = -1;
+    }
+
+    close(Connection);
+    return Worker;
+}
+
+BOOLEAN StopZygote(const char* SocketPath) {
+    char Request = ZYGOTE_STOP;
+    BOOLEAN Stopped;
+    int Connection = ConnectToZygote(SocketPath);
+
+    if (Connection == -1) {
+        return FALSE;
+    }
+
+    // The zygote echoes the request back once it stopped listening
+    Stopped = SendAll(Connection, &Request, sizeof(Request)) &&
+              ReceiveAll(Connection, &Request, sizeof(Request));
+
+    close(Connection);
+    return Stopped;
+}
+
+static BOOLEAN SetupZygoteAddress(const char* SocketPath, struct sockaddr_un* Address) {
+    size_t PathSize = Strlen(SocketPath) + 1;
+
+    if (PathSize > sizeof(Address->sun_path)) {
+        return FALSE;
+    }
+
+    memset(Address, 0, sizeof(*Address));
+    Address->sun_family = AF_UNIX;
+    Memcpy(Address->sun_path, SocketPath, PathSize);
+    return TRUE;
+}
+
+static int ConnectToZygote(const char* SocketPath) {
+    struct sockaddr_un Address;
+    int Connection;
+
+    if (SetupZygoteAddress(SocketPath, &Address) == FALSE) {
+        return -1;
+    }
+
+    Connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (Connection == -1) {
+        return -1;
+    }
+
+    if (SetSocketTimeout(Connection, ZYGOTE_REPLY_TIMEOUT_MS) == FALSE ||
+        connect(Connection, (struct sockaddr*)&Address, sizeof(Address)) != 0) {
+        close(Connection);
+        return -1;
+    }
+    return Connection;
+}
+
+/* Make sends and receives on `Socket` fail after `Milliseconds` */
+static BOOLEAN SetSocketTimeout(int Socket, unsigned Milliseconds) {
+    struct timeval Timeout = {
+        .tv_sec  = Milliseconds / 1000,
+        .tv_usec = (Milliseconds % 1000) * 1000,
+    };
+
+    return setsockopt(Socket, SOL_SOCKET, SO_RCVTIMEO, &Timeout, sizeof(Timeout)) == 0 &&
+           setsockopt(Socket, SOL_SOCKET, SO_SNDTIMEO, &Timeout, sizeof(Timeout)) == 0;
+}
+
+static BOOLEAN SendAll(int Socket, const void* Data, size_t Size) {
+    const uint8_t* Remaining = Data;
+
+    while (Size != 0) {
+        ssize_t Sent = send(Socket, Remaining, Size, MSG_NOSIGNAL);
+        if (Sent == -1 && errno == EINTR) {
+            continue;
+        }
+        if (Sent <= 0) {
+            return FALSE;
+        }
+        Remaining += Sent;
+        Size -= (size_t)Sent;
+    }
+    return TRUE;
+}
+
+static BOOLEAN ReceiveAll(int Socket, void* Data, size_t Size) {
+    uint8_t* Remaining = Data;
+
+    while (Size != 0) {
+        ssize_t Received = recv(Socket, Remaining, Size, 0);
+        if (Received == -1 && errno == EINTR) {
+            continue;
+        }
+        if (Received <= 0) {
+            return FALSE;
+        }
+        Remaining += Received;
+        Size -= (size_t)Received;
+    }
+    return TRUE;
+}